@@ -0,0 +1,139 @@
+// Page allocator scaling benchmark.
+// Runs two workloads with 1, 2, 4 ... workers up to one per
+// CPU, each for a fixed wall-clock time:
+//  - fork: fork() a child that touches a page and exits, and
+//    wait(), which allocates and frees page tables, a kernel
+//    stack and copy-on-write copies;
+//  - sbrk: grow the heap by 16 pages, touch them, and shrink
+//    it again;
+// and reports operations per second, how many kalloc()s the
+// per-CPU caches served, how often they went to the global
+// free list, and how often its lock had to wait.
+//
+// usage: allocbench [ms]
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "proc_type.h"
+#include "x86.h"
+
+#define NPG 16
+
+enum { FORK, SBRK, NTEST };
+char *names[NTEST] = { "fork", "sbrk" };
+
+uint64 end;
+char page[4096];
+
+int
+worker(int test)
+{
+  int i, n, pid;
+  char *a;
+
+  n = 0;
+  switch(test){
+  case FORK:
+    while(rdtsc() < end){
+      if((pid = fork()) < 0)
+        break;
+      if(pid == 0){
+        page[0] = 1;
+        exit();
+      }
+      wait();
+      n++;
+    }
+    break;
+  case SBRK:
+    while(rdtsc() < end){
+      if((a = sbrk(NPG * 4096)) == (char*)-1)
+        break;
+      for(i = 0; i < NPG; i++)
+        a[i * 4096] = 1;
+      sbrk(-NPG * 4096);
+      n++;
+    }
+    break;
+  }
+  return n;
+}
+
+// a per 1000 of b, without overflowing.
+uint
+permille(uint a, uint b)
+{
+  if(b == 0)
+    return 0;
+  if(b < 4000000)
+    return a * 1000 / b;
+  return a / (b / 1000);
+}
+
+void
+run(int test, int nworkers, int ms, uint tsckhz)
+{
+  struct vmstat a, b;
+  int i, n, total, fds[2];
+  uint allocs;
+
+  if(pipe(fds) < 0){
+    printf(1, "allocbench: pipe failed\n");
+    exit();
+  }
+  getvmstat(&a);
+  end = rdtsc() + (uint64)ms * tsckhz;
+  for(i = 0; i < nworkers; i++){
+    if(fork() == 0){
+      close(fds[0]);
+      n = worker(test);
+      write(fds[1], &n, sizeof(n));
+      exit();
+    }
+  }
+  close(fds[1]);
+  total = 0;
+  while(read(fds[0], &n, sizeof(n)) == sizeof(n))
+    total += n;
+  close(fds[0]);
+  for(i = 0; i < nworkers; i++)
+    wait();
+  getvmstat(&b);
+
+  b.kallochits -= a.kallochits;
+  b.kallocrefills -= a.kallocrefills;
+  b.kfreedrains -= a.kfreedrains;
+  b.kmemacquires -= a.kmemacquires;
+  b.kmemcontended -= a.kmemcontended;
+  allocs = b.kallochits + b.kallocrefills;
+  printf(1, "  %s x%d: %d ops/sec, %d kallocs, %d per 1000 from cache, "
+         "%d refills, %d drains, %d of %d kmem acquires contended\n",
+         names[test], nworkers, total / ms * 1000 + total % ms * 1000 / ms,
+         allocs, permille(b.kallochits, allocs),
+         b.kallocrefills, b.kfreedrains, b.kmemcontended, b.kmemacquires);
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct schedstat st;
+  struct schedconf conf;
+  int ms, t, w;
+
+  ms = argc > 1 ? atoi(argv[1]) : 1000;
+  if(ms <= 0)
+    ms = 1;
+  getschedstat(&st);
+  schedconf(&conf, 0);
+  printf(1, "allocbench: %d cpus, %d ms per run\n", st.ncpu, ms);
+  for(t = 0; t < NTEST; t++)
+    for(w = 1; ; w *= 2){
+      if(w > st.ncpu)
+        w = st.ncpu;
+      run(t, w, ms, conf.tsckhz);
+      if(w == st.ncpu)
+        break;
+    }
+  exit();
+}
@@ -9,12 +9,16 @@ struct spinlock;
 struct sleeplock;
 struct stat;
 struct superblock;
+struct vmstat;
 
 // PA #1
 struct ps_info;
 
 // PA #2
 struct pstat;
+struct pinfo;
+struct schedstat;
+struct tevent;
 
 // bio.c
 void            binit(void);
@@ -46,11 +50,15 @@ int             dirlink(struct inode*, char*, uint);
 struct inode*   dirlookup(struct inode*, char*, uint*);
 struct inode*   ialloc(uint, short);
 struct inode*   idup(struct inode*);
+struct inode*   iexecdup(struct inode*);
+void            iexecput(struct inode*);
 void            iinit(int dev);
 void            ilock(struct inode*);
 void            iput(struct inode*);
 void            iunlock(struct inode*);
 void            iunlockput(struct inode*);
+char*           ipage(struct inode*, uint);
+void            ipagestat(struct vmstat*);
 void            iupdate(struct inode*);
 int             namecmp(const char*, const char*);
 struct inode*   namei(char*);
@@ -72,6 +80,12 @@ void            ioapicinit(void);
 // kalloc.c
 char*           kalloc(void);
 void            kfree(char*);
+char*           kallocn(int);
+void            kfreen(char*, int);
+void            kdup(char*);
+int             krefs(char*);
+void            kallocstat(struct vmstat*);
+void            kalloctest(void);
 void            kinit1(void*, void*);
 void            kinit2(void*, void*);
 
@@ -84,6 +98,8 @@ int             cpunum(void);
 extern volatile uint*    lapic;
 void            lapiceoi(void);
 void            lapicinit(void);
+void            lapicipi(int, int);
+void            lapicarm(uint64);
 void            lapicstartap(uchar, uint);
 void            microdelay(int);
 
@@ -120,6 +136,7 @@ void            sched(void);
 void            sleep(void*, struct spinlock*);
 void            userinit(void);
 int             wait(void);
+int             waitpid(int, int);
 void            wakeup(void*);
 void            yield(void);
 
@@ -152,7 +169,7 @@ char*           strncpy(char*, const char*, int);
 
 // syscall.c
 int             argint(int, int*);
-int             argptr(int, char**, int);
+int             argptr(int, char**, int, int);
 int             argstr(int, char**);
 int             fetchint(uint, int*);
 int             fetchstr(uint, char**);
@@ -160,12 +177,21 @@ void            syscall(void);
 
 // timer.c
 void            timerinit(void);
+void            tsccalibrate(void);
+uint            tsc2us(uint64);
+uint            tsc2ticks(uint64);
+uint64          tick2tsc(uint);
+void            sethz(uint);
+extern uint     tsckhz;
+extern uint     tscpertick;
+extern uint     hz;
 
 // trap.c
 void            idtinit(void);
 extern uint     ticks;
 void            tvinit(void);
 extern struct spinlock tickslock;
+uint            tickupdate(void);
 
 // uart.c
 void            uartinit(void);
@@ -181,8 +207,13 @@ int             allocuvm(pde_t*, uint, uint);
 int             deallocuvm(pde_t*, uint, uint);
 void            freevm(pde_t*);
 void            inituvm(pde_t*, char*, uint);
-int             loaduvm(pde_t*, char*, struct inode*, uint, uint);
 pde_t*          copyuvm(pde_t*, uint);
+int             cowfault(pde_t*, uint);
+int             lazyalloc(pde_t*, uint, uint);
+int             pagein(struct proc*, uint);
+int             uvmtouch(struct proc*, uint, uint, int);
+uint            uvmrss(pde_t*, uint);
+int             getvmstat(struct vmstat*);
 void            switchuvm(struct proc*);
 void            switchkvm(void);
 int             copyout(pde_t*, uint, void*, uint);
@@ -197,7 +228,33 @@ int setnice(int, int);
 // PA #2
 //	proc.c
 int getpinfo(struct pstat*);
+int procinfo(int, struct pinfo*, int);
+struct lockstat;
+int getlockstat(struct lockstat*, int);
+void acct_user(struct proc*);
+void acct_kernel(struct proc*);
 void switch_to(struct proc*);
+void runq_enque(struct proc*);
+int runq_deque(struct proc*);
+void mlfq_boost(void);
+int sched_tick(struct proc*, int);
+int setsched(int);
+int reserve(int, int, int);
+int setboost(int);
+extern int boost_period;
+int getschedstat(struct schedstat*);
+int sleepticks(int);
+void timerq_expire(void);
+void timerarm(void);
+int settickless(int);
+struct schedconf;
+int schedconf(struct schedconf*, int);
+
+//	trace.c
+void traceinit(void);
+void trace(int, struct proc*, int);
+int settrace(int);
+int traceread(struct tevent*, int);
 
 // number of elements in fixed-size array
 #define NELEM(x) (sizeof(x)/sizeof((x)[0]))
@@ -0,0 +1,204 @@
+// Earliest-deadline-first real-time scheduling class.
+// A process with a reservation (see reserve() in proc.c) may
+// run for p->rt_runtime ticks in every p->rt_period ticks; the
+// current period ends at p->rt_deadline.  Queued processes with
+// budget left run in deadline order, ahead of every other
+// class.  One that uses up its budget is throttled until its
+// period ends, so it cannot take more than its share, and a
+// process that sleeps through the end of its period starts a
+// new one when it wakes.  Admission control in reserve() keeps
+// the shares within one CPU, which makes every deadline
+// feasible.
+//
+// Throttled processes are counted in rq->nparked, so a CPU
+// with only those queued halts until the first of them is due.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "proc_type.h"
+#include "sched.h"
+
+#define BEFORE(a, b) ((int)((a) - (b)) < 0)
+
+// p->qlevel tells which queue p is on.
+#define READY     0
+#define THROTTLED 1
+
+// Start p's next period: a full budget and a deadline one
+// period on, or one period from now if it fell behind.
+static void
+replenish(struct proc *p)
+{
+  p->rt_deadline += p->rt_period;
+  if(!BEFORE(ticks, p->rt_deadline))
+    p->rt_deadline = ticks + p->rt_period;
+  p->rt_budget = p->rt_runtime;
+}
+
+// Publish the number of throttled processes on rq and the
+// earliest end of their periods.
+static void
+park(struct runq *rq)
+{
+  struct proc *p;
+  uint end;
+  int n;
+
+  n = 0;
+  end = 0;
+  for(p = front(&rq->edf_throttled); p; p = p->qnext){
+    if(n == 0 || BEFORE(p->rt_deadline, end))
+      end = p->rt_deadline;
+    n++;
+  }
+  rq->parkend = end;
+  rq->nparked = n;
+}
+
+// File p in deadline order, FIFO among equals.
+static void
+insert(struct runq *rq, struct proc *p)
+{
+  struct proc *q;
+
+  for(q = front(&rq->edf); q; q = q->qnext)
+    if(BEFORE(p->rt_deadline, q->rt_deadline))
+      break;
+  if(q)
+    enque_before(&rq->edf, q, p);
+  else
+    enque(&rq->edf, p);
+  p->qlevel = READY;
+}
+
+static void
+edf_enqueue(struct runq *rq, struct proc *p)
+{
+  if(!BEFORE(ticks, p->rt_deadline))
+    replenish(p);
+  if(p->rt_budget <= 0){
+    enque(&rq->edf_throttled, p);
+    p->qlevel = THROTTLED;
+    park(rq);
+    return;
+  }
+  insert(rq, p);
+}
+
+static void
+edf_dequeue(struct runq *rq, struct proc *p)
+{
+  if(p->qlevel == THROTTLED){
+    deque_proc(&rq->edf_throttled, p);
+    park(rq);
+  } else
+    deque_proc(&rq->edf, p);
+}
+
+static struct proc*
+edf_pick_next(struct runq *rq)
+{
+  struct proc *p, *next;
+  int released;
+
+  // Release throttled processes whose period is over, and
+  // move on the deadlines of ready ones whose period ended
+  // before they got to run.
+  released = 0;
+  for(p = front(&rq->edf_throttled); p; p = next){
+    next = p->qnext;
+    if(!BEFORE(ticks, p->rt_deadline)){
+      deque_proc(&rq->edf_throttled, p);
+      replenish(p);
+      insert(rq, p);
+      released = 1;
+    }
+  }
+  if(released)
+    park(rq);
+  while((p = front(&rq->edf)) != 0 && !BEFORE(ticks, p->rt_deadline)){
+    deque(&rq->edf);
+    replenish(p);
+    insert(rq, p);
+  }
+  return deque(&rq->edf);
+}
+
+// Earliest ready deadline.  Throttled processes due for
+// release are not counted until pick_next releases them.
+static struct proc*
+edf_peek(struct runq *rq)
+{
+  return front(&rq->edf);
+}
+
+// Preempt p when its budget runs out, or when its period ends
+// so that it is queued again under its new deadline.
+static int
+edf_tick(struct proc *p)
+{
+  p->timeslice++;
+  p->rt_budget--;
+  return p->rt_budget <= 0 || !BEFORE(ticks, p->rt_deadline);
+}
+
+// The end of the budget, or of the period if that is first.
+static uint64
+edf_slice_end(struct proc *p)
+{
+  uint now, end;
+
+  now = tsc2ticks(rdtsc());
+  end = now + (p->rt_budget > 0 ? p->rt_budget : 1);
+  if(BEFORE(p->rt_deadline, end) && BEFORE(now, p->rt_deadline))
+    end = p->rt_deadline;
+  return tick2tsc(end);
+}
+
+static void
+edf_yield(struct proc *p)
+{
+}
+
+static int
+edf_preempt(struct proc *running, struct proc *p)
+{
+  return BEFORE(p->rt_deadline, running->rt_deadline);
+}
+
+// Nice values are kept as MLFQ levels, 0..3, for when the
+// reservation is dropped.
+static int
+edf_setnice(struct proc *p, int value)
+{
+  if(value < 0 || value > 3)
+    return -1;
+  p->niceness = value;
+  return 0;
+}
+
+static int
+edf_getnice(struct proc *p)
+{
+  return p->niceness;
+}
+
+struct sched_class edf_class = {
+  .name = "edf",
+  .policy = SCHED_EDF,
+  .enqueue = edf_enqueue,
+  .dequeue = edf_dequeue,
+  .pick_next = edf_pick_next,
+  .peek = edf_peek,
+  .tick = edf_tick,
+  .slice_end = edf_slice_end,
+  .yield = edf_yield,
+  .preempt = edf_preempt,
+  .setnice = edf_setnice,
+  .getnice = edf_getnice,
+};
@@ -0,0 +1,115 @@
+// EDF reservation test.
+// Starts nhogs CPU-bound loop processes, then runs a periodic
+// job -- about a tick of work released every PERIOD ticks,
+// due by the next release -- for njobs periods, first as an
+// ordinary process and then with an EDF reservation of
+// RUNTIME ticks per PERIOD, and counts the jobs that miss
+// their deadline.  Also checks that admission control turns
+// down a reservation that would overcommit the CPU.
+//
+// usage: edftest [nhogs [njobs]]
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+#define PERIOD 10
+#define RUNTIME 3
+#define CHUNK 10000
+
+// Chunks of CHUNK iterations that fit in one tick with the
+// CPU to ourselves.
+int
+calibrate(void)
+{
+  volatile int i;
+  int t, n;
+
+  t = uptime();
+  while(uptime() == t)
+    ;
+  t = uptime();
+  for(n = 0; uptime() < t + 10; n++)
+    for(i = 0; i < CHUNK; i++)
+      ;
+  return n / 10;
+}
+
+// Run njobs periodic jobs of work chunks each and return how
+// many finished after their deadline.
+int
+periodic(int work, int njobs)
+{
+  volatile int i;
+  int j, k, release, misses;
+
+  misses = 0;
+  release = uptime() + 1;
+  for(k = 0; k < njobs; k++){
+    if(release > uptime())
+      sleep(release - uptime());
+    for(j = 0; j < work; j++)
+      for(i = 0; i < CHUNK; i++)
+        ;
+    if(uptime() > release + PERIOD)
+      misses++;
+    release += PERIOD;
+  }
+  return misses;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int nhogs, njobs, work, i, n, pid, pids[16];
+  int before, after, refused;
+
+  nhogs = argc > 1 ? atoi(argv[1]) : 4;
+  njobs = argc > 2 ? atoi(argv[2]) : 100;
+  if(nhogs > 16)
+    nhogs = 16;
+
+  work = calibrate();
+  printf(1, "edftest: %d chunks per tick, %d hogs, %d jobs, "
+         "period %d, runtime %d\n", work, nhogs, njobs, PERIOD, RUNTIME);
+
+  for(n = 0; n < nhogs; n++){
+    pid = fork();
+    if(pid < 0)
+      break;
+    if(pid == 0){
+      for(;;)
+        ;
+    }
+    pids[n] = pid;
+  }
+
+  before = periodic(work, njobs);
+  printf(1, "  without reservation: %d/%d deadlines missed\n", before, njobs);
+
+  if(reserve(getpid(), RUNTIME, PERIOD) < 0){
+    printf(1, "edftest: reserve failed\n");
+    after = njobs;
+  } else {
+    after = periodic(work, njobs);
+    printf(1, "  with reservation: %d/%d deadlines missed\n", after, njobs);
+  }
+
+  // RUNTIME/PERIOD is already taken, so PERIOD-RUNTIME more
+  // would fill the CPU; admission control must say no.
+  refused = n > 0 && reserve(pids[0], PERIOD - RUNTIME, PERIOD) < 0;
+  printf(1, "  overcommitting reservation %s\n",
+         refused ? "refused" : "ACCEPTED");
+
+  reserve(getpid(), 0, 0);
+  for(i = 0; i < n; i++)
+    kill(pids[i]);
+  for(i = 0; i < n; i++)
+    wait();
+
+  if(after == 0 && (refused || n == 0))
+    printf(1, "edftest ok\n");
+  else
+    printf(1, "edftest failed\n");
+  exit();
+}
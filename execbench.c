@@ -0,0 +1,131 @@
+// Exec latency and memory for many copies of one program.
+// Runs sh N times one after another, each with standard input
+// at end of file so it exits at once, and reports the time per
+// fork+exec+exit.  Then starts C copies of sh that block
+// reading a pipe, and reports the memory they take, in all and
+// per copy, with their resident sizes and the page cache
+// counters.  Closing the pipe lets them go.
+//
+// usage: execbench [n [c]]
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "proc_type.h"
+#include "x86.h"
+
+char *args[] = { "sh", 0 };
+
+// Fork and exec sh reading pipe in, with standard output and
+// error to pipe out.
+int
+spawn(int *in, int *out)
+{
+  int pid;
+
+  pid = fork();
+  if(pid != 0)
+    return pid;
+  close(0);
+  dup(in[0]);
+  close(1);
+  dup(out[1]);
+  close(2);
+  dup(out[1]);
+  close(in[0]);
+  close(in[1]);
+  close(out[0]);
+  close(out[1]);
+  exec(args[0], args);
+  exit();
+}
+
+// Resident kilobytes of process pid.
+uint
+rss(int pid)
+{
+  struct ps_info info;
+
+  info.start = 0;
+  ps_inside(pid, &info);
+  return info.arr_len == 1 ? info.arr[0].rss : 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct schedconf conf;
+  struct vmstat v0, v1;
+  int n, c, i, k, in[2], out[2], pids[64];
+  uint64 t0, t1;
+  uint kb;
+  char buf[2];
+
+  n = argc > 1 ? atoi(argv[1]) : 50;
+  c = argc > 2 ? atoi(argv[2]) : 20;
+  if(n <= 0)
+    n = 1;
+  if(c <= 0 || c > 64)
+    c = 20;
+  schedconf(&conf, 0);
+
+  // Output goes to a pipe nobody reads, so sh's prompts fail
+  // quietly instead of filling the console.
+  if(pipe(in) < 0 || pipe(out) < 0){
+    printf(1, "execbench: pipe failed\n");
+    exit();
+  }
+  close(in[1]);
+  close(out[0]);
+  in[1] = out[0] = -1;
+  getvmstat(&v0);
+  t0 = rdtsc();
+  for(i = 0; i < n; i++){
+    if(spawn(in, out) < 0)
+      break;
+    wait();
+  }
+  t1 = rdtsc();
+  getvmstat(&v1);
+  close(in[0]);
+  close(out[1]);
+  if(i == 0){
+    printf(1, "execbench: fork failed\n");
+    exit();
+  }
+  printf(1, "execbench: sh x%d: %d us/fork+exec+exit, %d pages in, %d read\n",
+         i, usper(t1 - t0, i, conf.tsckhz), (v1.pageins - v0.pageins) / i,
+         (v1.ipagereads - v0.ipagereads) / i);
+
+  // c copies that each prompt and then block on in.
+  if(pipe(in) < 0 || pipe(out) < 0){
+    printf(1, "execbench: pipe failed\n");
+    exit();
+  }
+  getvmstat(&v0);
+  t0 = rdtsc();
+  for(i = 0; i < c; i++)
+    if((pids[i] = spawn(in, out)) < 0)
+      break;
+  c = i;
+  for(i = 0; i < 2 * c; i += k)
+    if((k = read(out[0], buf, sizeof(buf))) <= 0)
+      break;
+  t1 = rdtsc();
+  getvmstat(&v1);
+  kb = 0;
+  for(i = 0; i < c; i++)
+    kb += rss(pids[i]);
+  if(c > 0)
+    printf(1, "execbench: %d sh up in %d us each: %d pages, %d per copy, "
+           "rss %dK per copy, %d pages cached\n",
+           c, usper(t1 - t0, c, conf.tsckhz), v0.freepages - v1.freepages,
+           (v0.freepages - v1.freepages) / c, kb / c, v1.ipagecached);
+  close(in[0]);
+  close(in[1]);
+  close(out[0]);
+  close(out[1]);
+  for(i = 0; i < c; i++)
+    wait();
+  exit();
+}
@@ -23,6 +23,9 @@ struct inode {
   short nlink;
   uint size;
   uint addrs[NDIRECT+1];
+
+  struct ipage *pages;  // cached executable pages, see ipage()
+  int nexec;          // processes running it, see iexecdup()
 };
 #define I_VALID 0x2
 
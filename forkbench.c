@@ -0,0 +1,181 @@
+// Context switches per fork.
+// Forks N children that exit at once and waits for each, then
+// forks N children that the parent waits for only after
+// forking them all, and reports how many context switches
+// each fork cost.  A fork that does not hand the CPU to the
+// child costs two: into the child and back to the parent.
+// Then parks M children on a pipe all at once, well past the
+// first slab of process slots, and times the forks and the
+// reaping.  Last, grows the heap through a range of sizes and
+// times fork+exec at each, with the pages fork() shared and
+// the pages that copy-on-write faults then had to copy.
+//
+// usage: forkbench [n [m]]
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "proc_type.h"
+#include "x86.h"
+
+int
+switches(void)
+{
+  struct schedstat st;
+
+  getschedstat(&st);
+  return st.nswitch;
+}
+
+void
+report(char *what, int n, int s0)
+{
+  int s;
+
+  if(n == 0){
+    printf(1, "  %s: fork failed\n", what);
+    return;
+  }
+  s = switches() - s0;
+  printf(1, "  %s: %d forks, %d switches, %d.%d per fork\n",
+         what, n, s, s / n, s * 10 / n % 10);
+}
+
+// Milliseconds in TSC cycles d, without 64-bit division.
+uint
+ms(uint64 d, uint tsckhz)
+{
+  return (uint)(d >> 10) / ((tsckhz >> 10) + 1);
+}
+
+// Fork m children that block on a pipe until they are all up.
+void
+park(int m)
+{
+  struct schedconf conf;
+  int fds[2], i, n, pid;
+  uint64 t0, t1, t2;
+  char c;
+
+  schedconf(&conf, 0);
+  if(pipe(fds) < 0){
+    printf(1, "  park: pipe failed\n");
+    return;
+  }
+  t0 = rdtsc();
+  for(n = 0; n < m; n++){
+    pid = fork();
+    if(pid < 0)
+      break;
+    if(pid == 0){
+      close(fds[1]);
+      read(fds[0], &c, 1);
+      exit();
+    }
+  }
+  t1 = rdtsc();
+  close(fds[0]);
+  close(fds[1]);
+  for(i = 0; i < n; i++)
+    wait();
+  t2 = rdtsc();
+  if(n == 0){
+    printf(1, "  park: fork failed\n");
+    return;
+  }
+  printf(1, "  park: %d of %d forks in %d ms, reaped in %d ms (%d us/fork)\n",
+         n, m, ms(t1 - t0, conf.tsckhz), ms(t2 - t1, conf.tsckhz),
+         ms(t1 - t0, conf.tsckhz) * 1000 / n);
+}
+
+// Time fork+exec with a heap of kb kilobytes, every page
+// of it written so it is mapped and dirty.
+void
+forkexec(int kb, int n)
+{
+  static char *args[] = { "forkbench", "-exit", 0 };
+  struct schedconf conf;
+  struct vmstat v0, v1;
+  char *heap;
+  uint64 t0, t1;
+  int i, pid;
+
+  schedconf(&conf, 0);
+  heap = sbrk(kb * 1024);
+  if(heap == (char*)-1){
+    printf(1, "  exec %dK: sbrk failed\n", kb);
+    return;
+  }
+  for(i = 0; i < kb * 1024; i += 4096)
+    heap[i] = i;
+  getvmstat(&v0);
+  t0 = rdtsc();
+  for(i = 0; i < n; i++){
+    pid = fork();
+    if(pid < 0)
+      break;
+    if(pid == 0){
+      exec(args[0], args);
+      printf(1, "  exec %dK: exec failed\n", kb);
+      exit();
+    }
+    wait();
+  }
+  t1 = rdtsc();
+  getvmstat(&v1);
+  sbrk(-kb * 1024);
+  if(i == 0){
+    printf(1, "  exec %dK: fork failed\n", kb);
+    return;
+  }
+  printf(1, "  exec %dK: %d us/fork+exec, %d pages shared, %d copied per fork\n",
+         kb, usper(t1 - t0, i, conf.tsckhz),
+         (v1.cowshared - v0.cowshared) / i, (v1.cowcopies - v0.cowcopies) / i);
+}
+
+int
+main(int argc, char *argv[])
+{
+  static int sizes[] = { 0, 64, 256, 1024, 4096 };
+  int n, m, i, s0, pid;
+
+  if(argc > 1 && strcmp(argv[1], "-exit") == 0)
+    exit();
+  n = argc > 1 ? atoi(argv[1]) : 200;
+  m = argc > 2 ? atoi(argv[2]) : 1000;
+  if(n <= 0)
+    n = 1;
+  printf(1, "forkbench: %d forks\n", n);
+
+  s0 = switches();
+  for(i = 0; i < n; i++){
+    pid = fork();
+    if(pid < 0)
+      break;
+    if(pid == 0)
+      exit();
+    wait();
+  }
+  report("fork+wait", i, s0);
+
+  if(n > 32)
+    n = 32;
+  s0 = switches();
+  for(i = 0; i < n; i++){
+    pid = fork();
+    if(pid < 0)
+      break;
+    if(pid == 0)
+      exit();
+  }
+  n = i;
+  for(i = 0; i < n; i++)
+    wait();
+  report("batch", n, s0);
+
+  park(m);
+
+  for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    forkexec(sizes[i], 20);
+  exit();
+}
@@ -4,8 +4,9 @@
 #include "types.h"
 #include "stat.h"
 #include "user.h"
+#include "param.h"
 
-#define N  1000
+#define N  (NPROC + 1)
 
 void
 printf(int fd, char *s, ...)
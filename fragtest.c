@@ -0,0 +1,131 @@
+// Physical memory fragmentation stress test.
+// Keeps up to N children alive, each holding a random number
+// of heap pages, so that their pages interleave in physical
+// memory.  Every round it kills a random half of them, starts
+// new ones in their place, and prints the free pages, the
+// largest free block and the free blocks of each order.  At
+// the end it kills them all and checks that freed memory
+// merged back into blocks as large as at the start.
+//
+// usage: fragtest [rounds [n]]
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "proc_type.h"
+
+#define MAXCHILD 64
+
+uint seed = 1;
+
+uint
+rnd(void)
+{
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 16) & 0x7fff;
+}
+
+// Largest order with a free block, or -1.
+int
+largest(struct vmstat *v)
+{
+  int k;
+
+  for(k = NORDER - 1; k >= 0; k--)
+    if(v->freeblocks[k])
+      return k;
+  return -1;
+}
+
+void
+report(void)
+{
+  struct vmstat v;
+  int k;
+
+  getvmstat(&v);
+  k = largest(&v);
+  printf(1, "%d pages free, largest block %dK, blocks",
+         v.freepages, k < 0 ? 0 : 4 << k);
+  for(k = 0; k < NORDER; k++)
+    printf(1, " %d", v.freeblocks[k]);
+  printf(1, "\n");
+}
+
+// Start a child that takes npg heap pages and waits to be
+// killed.  It writes a byte to fd once its pages are in.
+int
+spawn(int npg, int fd)
+{
+  int pid, i;
+  char *a;
+
+  pid = fork();
+  if(pid != 0)
+    return pid;
+  a = sbrk(npg * 4096);
+  if(a != (char*)-1)
+    for(i = 0; i < npg; i++)
+      a[i * 4096] = i;
+  write(fd, "x", 1);
+  for(;;)
+    sleep(1000);
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct vmstat v;
+  int rounds, n, r, i, fds[2], pids[MAXCHILD], before;
+  char c;
+
+  rounds = argc > 1 ? atoi(argv[1]) : 10;
+  n = argc > 2 ? atoi(argv[2]) : 32;
+  if(n <= 0 || n > MAXCHILD)
+    n = 32;
+  if(pipe(fds) < 0){
+    printf(1, "fragtest: pipe failed\n");
+    exit();
+  }
+  getvmstat(&v);
+  before = largest(&v);
+  printf(1, "start: ");
+  report();
+
+  for(i = 0; i < n; i++)
+    pids[i] = 0;
+  for(r = 0; r < rounds; r++){
+    for(i = 0; i < n; i++){
+      if(pids[i] > 0)
+        continue;
+      if((pids[i] = spawn(1 + rnd() % 256, fds[1])) < 0)
+        break;
+      read(fds[0], &c, 1);
+    }
+    for(i = 0; i < n; i++){
+      if(pids[i] > 0 && rnd() % 2){
+        kill(pids[i]);
+        waitpid(pids[i], 0);
+        pids[i] = 0;
+      }
+    }
+    printf(1, "round %d: ", r + 1);
+    report();
+  }
+
+  for(i = 0; i < n; i++){
+    if(pids[i] > 0){
+      kill(pids[i]);
+      waitpid(pids[i], 0);
+    }
+  }
+  printf(1, "end: ");
+  report();
+  getvmstat(&v);
+  if(largest(&v) < before)
+    printf(1, "fragtest: largest block shrank from %dK to %dK\n",
+           4 << before, largest(&v) < 0 ? 0 : 4 << largest(&v));
+  else
+    printf(1, "fragtest ok\n");
+  exit();
+}
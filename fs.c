@@ -14,15 +14,17 @@
 #include "param.h"
 #include "stat.h"
 #include "mmu.h"
-#include "proc.h"
 #include "spinlock.h"
+#include "proc.h"
 #include "sleeplock.h"
 #include "fs.h"
 #include "buf.h"
 #include "file.h"
+#include "proc_type.h"
 
 #define min(a, b) ((a) < (b) ? (a) : (b))
 static void itrunc(struct inode*);
+static void ipagesfree(struct inode*);
 // there should be one superblock per disk device, but we run with
 // only one device
 struct superblock sb; 
@@ -160,6 +162,21 @@ struct {
   struct inode inode[NINODE];
 } icache;
 
+// Cached pages of executables, see ipage().
+struct ipage {
+  uint off;             // file offset of the page
+  char *page;
+  struct ipage *next;   // next on the inode's list or free
+};
+
+struct {
+  struct spinlock lock;
+  struct ipage pages[NIPAGE];
+  struct ipage *free;
+  uint ncached;
+  uint nread;
+} ipcache;
+
 void
 iinit(int dev)
 {
@@ -169,6 +186,11 @@ iinit(int dev)
   for(i = 0; i < NINODE; i++) {
     initsleeplock(&icache.inode[i].lock, "inode");
   }
+  initlock(&ipcache.lock, "ipcache");
+  for(i = 0; i < NIPAGE; i++){
+    ipcache.pages[i].next = ipcache.free;
+    ipcache.free = &ipcache.pages[i];
+  }
   
   readsb(dev, &sb);
 }
@@ -246,10 +268,12 @@ iget(uint dev, uint inum)
     panic("iget: no inodes");
 
   ip = empty;
+  ipagesfree(ip);
   ip->dev = dev;
   ip->inum = inum;
   ip->ref = 1;
   ip->flags = 0;
+  ip->nexec = 0;
   release(&icache.lock);
 
   return ip;
@@ -266,6 +290,29 @@ idup(struct inode *ip)
   return ip;
 }
 
+// Like idup(), for a process that runs ip as its program and
+// pages it in on demand.  writei() refuses to change ip until
+// each such reference is dropped with iexecput().
+struct inode*
+iexecdup(struct inode *ip)
+{
+  acquire(&icache.lock);
+  ip->ref++;
+  ip->nexec++;
+  release(&icache.lock);
+  return ip;
+}
+
+// Drop a reference from iexecdup().
+void
+iexecput(struct inode *ip)
+{
+  acquire(&icache.lock);
+  ip->nexec--;
+  release(&icache.lock);
+  iput(ip);
+}
+
 // Lock the given inode.
 // Reads the inode from disk if necessary.
 void
@@ -389,6 +436,7 @@ itrunc(struct inode *ip)
   struct buf *bp;
   uint *a;
 
+  ipagesfree(ip);
   for(i = 0; i < NDIRECT; i++){
     if(ip->addrs[i]){
       bfree(ip->dev, ip->addrs[i]);
@@ -477,6 +525,12 @@ writei(struct inode *ip, char *src, uint off, uint n)
   if(off + n > MAXFILE*BSIZE)
     return -1;
 
+  // A running program pages itself in from ip, and must not
+  // see a mix of old and new contents.
+  if(ip->nexec > 0)
+    return -1;
+  ipagesfree(ip);
+
   for(tot=0; tot<n; tot+=m, off+=m, src+=m){
     bp = bread(ip->dev, bmap(ip, off/BSIZE));
     m = min(n - tot, BSIZE - off%BSIZE);
@@ -492,6 +546,77 @@ writei(struct inode *ip, char *src, uint off, uint n)
   return n;
 }
 
+// Return the page of ip's contents at byte offset off, zero
+// past the end of the file, with a reference for the caller.
+// The page fault handler maps program pages from here, so
+// processes running the same executable share one copy of
+// each page; keep it read-only or copy-on-write.  off need not
+// be page aligned: the cache is keyed by the exact offset,
+// which is the same in every process.  Caller must hold
+// ip->lock.  Returns 0 if out of memory.
+char*
+ipage(struct inode *ip, uint off)
+{
+  struct ipage *e;
+  char *mem;
+  int n;
+
+  for(e = ip->pages; e; e = e->next)
+    if(e->off == off){
+      kdup(e->page);
+      return e->page;
+    }
+  if((mem = kalloc()) == 0)
+    return 0;
+  if((n = readi(ip, mem, off, PGSIZE)) < 0)
+    n = 0;
+  memset(mem + n, 0, PGSIZE - n);
+
+  // Keep it if there is room; the cache holds a reference.
+  acquire(&ipcache.lock);
+  ipcache.nread++;
+  if((e = ipcache.free) != 0){
+    ipcache.free = e->next;
+    ipcache.ncached++;
+  }
+  release(&ipcache.lock);
+  if(e){
+    e->off = off;
+    e->page = mem;
+    e->next = ip->pages;
+    ip->pages = e;
+    kdup(mem);
+  }
+  return mem;
+}
+
+// Drop ip's cached pages, because its contents change or its
+// cache entry is being reused.  Processes that mapped them
+// keep their references.
+static void
+ipagesfree(struct inode *ip)
+{
+  struct ipage *e;
+
+  while((e = ip->pages) != 0){
+    ip->pages = e->next;
+    kfree(e->page);
+    acquire(&ipcache.lock);
+    e->next = ipcache.free;
+    ipcache.free = e;
+    ipcache.ncached--;
+    release(&ipcache.lock);
+  }
+}
+
+// Page cache counters for getvmstat().
+void
+ipagestat(struct vmstat *st)
+{
+  st->ipagecached = ipcache.ncached;
+  st->ipagereads = ipcache.nread;
+}
+
 //PAGEBREAK!
 // Directories
 
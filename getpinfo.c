@@ -5,25 +5,94 @@
 #include "user.h"
 #include "proc_type.h"
 
-int main(int argc, char** argv) {
-	struct pstat proc_state;
-	
-	if(getpinfo(&proc_state) == -1)
-	{
-		printf(1, "error: getpinfo: invalid pstat pointer\n");
+// Too big for the user stack.
+#define CHUNK 16
+struct pinfo info[CHUNK];
+
+// Upper bound, in units of 1024 cycles, of the bucket holding
+// the pct-th percentile of histogram h, or -1 if h is empty.
+// The last bucket has no bound and is reported as its lower one.
+int percentile(uint* h, int pct)
+{
+	uint total = 0, seen = 0, target;
+	int b;
+
+	for (b = 0; b < NHIST; b++)
+		total += h[b];
+	if (total == 0)
+		return -1;
+	target = (total * pct + 99) / 100;
+	for (b = 0; b < NHIST - 1; b++) {
+		seen += h[b];
+		if (seen >= target)
+			break;
 	}
-	
-	printf(2, "used?\tnice\tpid\tticks\n");
-	printf(2, "--------------------------\n");
-	
-	for (int i = 0; i < NPROC; i++) 
+	return b == NHIST - 1 ? 1 << (b - 1) : 1 << b;
+}
+
+void printpct(uint* h, int pct, char* sep)
+{
+	int v = percentile(h, pct);
+
+	if (v < 0)
+		printf(2, "-%s", sep);
+	else
+		printf(2, "%d%s", v, sep);
+}
+
+void printrow(struct pinfo* r)
+{
+	printf(2, "%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\n",
+	r->slot,
+	r->nice,
+	r->pid,
+	r->ticks,
+	r->wait,
+	r->maxwait,
+	r->utime,
+	r->stime);
+}
+
+// Percentiles in units of 1024 TSC cycles.
+void printhist(struct pinfo* r)
+{
+	int l;
+
+	printf(2, "%d\t", r->pid);
+	printpct(r->rundelay, 50, "/");
+	printpct(r->rundelay, 90, "/");
+	printpct(r->rundelay, 99, "\t");
+	for (l = 0; l < 4; l++) {
+		printpct(r->inqueue[l], 50, "/");
+		printpct(r->inqueue[l], 99, l < 3 ? "\t" : "\n");
+	}
+}
+
+// Call f on every process in use, CHUNK at a time.
+int each(void (*f)(struct pinfo*))
+{
+	int i, n, slot = 0;
+
+	while ((n = procinfo(slot, info, CHUNK)) > 0) {
+		for (i = 0; i < n; i++)
+			f(info + i);
+		slot = info[n - 1].slot + 1;
+	}
+	return n;
+}
+
+int main(int argc, char** argv) {
+	printf(2, "slot\tnice\tpid\tticks\twait\tmaxwait\tuser(us)\tsys(us)\n");
+	printf(2, "------------------------------------------\n");
+	if (each(printrow) < 0)
 	{
-		printf(2, "%s\t%d\t%d\t%d\n", 
-		proc_state.inuse[i] ? "yes" : "no ",
-		proc_state.nice[i],
-		proc_state.pid[i],
-		proc_state.ticks[i]);
+		printf(1, "error: getpinfo: procinfo failed\n");
+		exit();
 	}
-	
+
+	printf(2, "\nrun delay p50/p90/p99, time queued per level p50/p99 (kcycles)\n");
+	printf(2, "pid\tdelay\t\tL0\tL1\tL2\tL3\n");
+	each(printhist);
+
 	exit();
-}
\ No newline at end of file
+}
@@ -0,0 +1,82 @@
+// Timer interrupt load, periodic vs tickless.
+// Counts timer interrupts per second on every CPU, first with
+// each CPU taking every tick and then tickless, while the
+// system is idle and then while one loop hog runs.
+//
+// usage: idlebench [ticks]
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "proc_type.h"
+
+struct schedconf conf;
+
+int
+total(struct schedstat *st)
+{
+  int c, n;
+
+  n = 0;
+  for(c = 0; c < st->ncpu; c++)
+    n += st->cpu_intr[c];
+  return n;
+}
+
+// Timer interrupts per second, summed over CPUs, during a
+// sleep of len ticks.
+int
+measure(int len)
+{
+  struct schedstat a, b;
+  int t0, dt;
+
+  getschedstat(&a);
+  t0 = uptime();
+  sleep(len);
+  dt = uptime() - t0;
+  getschedstat(&b);
+  if(dt <= 0)
+    dt = 1;
+  return (total(&b) - total(&a)) * conf.hz / dt;
+}
+
+void
+run(char *what, int len, int hog)
+{
+  int pid, periodic, tickless;
+
+  pid = 0;
+  if(hog && (pid = fork()) == 0){
+    for(;;)
+      ;
+  }
+  settickless(0);
+  periodic = measure(len);
+  settickless(1);
+  tickless = measure(len);
+  if(pid > 0){
+    kill(pid);
+    wait();
+  }
+  printf(1, "  %s: %d interrupts/sec periodic, %d tickless\n",
+         what, periodic, tickless);
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct schedstat st;
+  int len, old;
+
+  len = argc > 1 ? atoi(argv[1]) : 200;
+  getschedstat(&st);
+  schedconf(&conf, 0);
+  old = settickless(-1);
+  printf(1, "idlebench: %d cpus, %d ticks per run, HZ %d\n",
+         st.ncpu, len, conf.hz);
+  run("idle", len, 0);
+  run("one hog", len, 1);
+  settickless(old);
+  exit();
+}
@@ -1,6 +1,25 @@
 // Physical memory allocator, intended to allocate
 // memory for user processes, kernel stacks, page table pages,
-// and pipe buffers. Allocates 4096-byte pages.
+// and pipe buffers.  A buddy allocator: free memory is kept in
+// blocks of 2^order pages, aligned to their size, for orders
+// 0 to MAXORDER (4096 bytes to 4MB).  kallocn() splits a
+// larger block when no block of the asked-for order is free,
+// and kfreen() merges a block with its free buddy, the other
+// half of the block of the next order, as far as it can.
+//
+// Each page carries a reference count so that fork() can map
+// one page into several address spaces copy-on-write.  kalloc()
+// returns a page with one reference, kdup() adds one and
+// kfree() drops one, freeing the page when none are left.
+//
+// kalloc() and kfree() are the fast path for single pages.
+// Each CPU keeps a cache of up to MAGSIZE free pages that they
+// use with interrupts off and no lock.  An empty cache is
+// refilled with MAGBATCH pages from the buddy allocator, and a
+// full one drains MAGBATCH pages back, so kmem.lock is taken
+// once per MAGBATCH pages at most.  Pages in other CPUs'
+// caches are not available to kalloc(), and are not merged
+// into larger blocks until they drain.
 
 #include "types.h"
 #include "defs.h"
@@ -8,20 +27,44 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "spinlock.h"
+#include "proc.h"
+#include "proc_type.h"
+
+#define MAXORDER  (NORDER-1)
+#define MAGSIZE   64
+#define MAGBATCH  32
 
 void freerange(void *vstart, void *vend);
 extern char end[]; // first address after kernel loaded from ELF file
 
 struct run {
   struct run *next;
+  struct run *prev;   // only on the buddy free lists
+};
+
+// A CPU's cache of free pages.
+struct magazine {
+  struct run *freelist;
+  int n;
+  uint hits;     // kalloc()s it served
+  uint refills;  // times it was refilled from kmem
+  uint drains;   // times it was drained to kmem
 };
 
 struct {
   struct spinlock lock;
   int use_lock;
-  struct run *freelist;
+  struct run free[NORDER];  // circular lists of free blocks
+  uint nblock[NORDER];      // blocks on each list
+  uint nfree;               // pages in free blocks
+  struct magazine mag[NCPU];
+  uchar order[PHYSTOP >> PGSHIFT];  // 1 + order of free block here
+  ushort ref[PHYSTOP >> PGSHIFT];   // references per physical page
 } kmem;
 
+#define PGNUM(v)  (V2P(v) >> PGSHIFT)
+#define REF(v)    kmem.ref[PGNUM(v)]
+
 // Initialization happens in two phases.
 // 1. main() calls kinit1() while still using entrypgdir to place just
 // the pages mapped by entrypgdir on free list.
@@ -30,8 +73,12 @@ struct {
 void
 kinit1(void *vstart, void *vend)
 {
+  int k;
+
   initlock(&kmem.lock, "kmem");
   kmem.use_lock = 0;
+  for(k = 0; k < NORDER; k++)
+    kmem.free[k].next = kmem.free[k].prev = &kmem.free[k];
   freerange(vstart, vend);
 }
 
@@ -47,33 +94,215 @@ freerange(void *vstart, void *vend)
 {
   char *p;
   p = (char*)PGROUNDUP((uint)vstart);
-  for(; p + PGSIZE <= (char*)vend; p += PGSIZE)
+  for(; p + PGSIZE <= (char*)vend; p += PGSIZE){
+    REF(p) = 1;
     kfree(p);
+  }
+}
+
+//PAGEBREAK: 30
+// Take a free block of 2^order pages off the free lists,
+// splitting a larger one if need be.  Caller holds kmem.lock.
+static char*
+buddyalloc(int order)
+{
+  struct run *r, *b;
+  int k;
+
+  for(k = order; k <= MAXORDER; k++)
+    if(kmem.free[k].next != &kmem.free[k])
+      break;
+  if(k > MAXORDER)
+    return 0;
+  r = kmem.free[k].next;
+  r->prev->next = r->next;
+  r->next->prev = r->prev;
+  kmem.nblock[k]--;
+  kmem.order[PGNUM(r)] = 0;
+
+  // Put back the upper half of each split.
+  while(k > order){
+    k--;
+    b = (struct run*)((char*)r + (PGSIZE << k));
+    b->next = kmem.free[k].next;
+    b->prev = &kmem.free[k];
+    b->next->prev = b;
+    kmem.free[k].next = b;
+    kmem.nblock[k]++;
+    kmem.order[PGNUM(b)] = k + 1;
+  }
+  kmem.nfree -= 1 << order;
+  return (char*)r;
+}
+
+// Return the block of 2^order pages at v to the free lists,
+// merging it with its buddy for as long as the buddy is free.
+// Caller holds kmem.lock.
+static void
+buddyfree(char *v, int order)
+{
+  struct run *r, *b;
+  uint pa, bpa;
+
+  kmem.nfree += 1 << order;
+  pa = V2P(v);
+  for(; order < MAXORDER; order++){
+    bpa = pa ^ (PGSIZE << order);
+    if(bpa >= PHYSTOP || kmem.order[bpa >> PGSHIFT] != order + 1)
+      break;
+    b = (struct run*)P2V(bpa);
+    b->prev->next = b->next;
+    b->next->prev = b->prev;
+    kmem.nblock[order]--;
+    kmem.order[bpa >> PGSHIFT] = 0;
+    pa &= ~(PGSIZE << order);
+  }
+  r = (struct run*)P2V(pa);
+  r->next = kmem.free[order].next;
+  r->prev = &kmem.free[order];
+  r->next->prev = r;
+  kmem.free[order].next = r;
+  kmem.nblock[order]++;
+  kmem.order[pa >> PGSHIFT] = order + 1;
+}
+
+// Allocate 2^order physically contiguous pages, aligned to
+// their size.  Returns a pointer that the kernel can use, or
+// 0 if there is no free block that large.  Free with kfreen().
+char*
+kallocn(int order)
+{
+  char *v;
+  int i;
+
+  if(order < 0 || order > MAXORDER)
+    return 0;
+  if(kmem.use_lock)
+    acquire(&kmem.lock);
+  v = buddyalloc(order);
+  if(kmem.use_lock)
+    release(&kmem.lock);
+  if(v)
+    for(i = 0; i < 1 << order; i++)
+      REF(v + i*PGSIZE) = 1;
+  return v;
+}
+
+// Free 2^order pages at v that kallocn(order) returned.
+void
+kfreen(char *v, int order)
+{
+  int i;
+
+  if((uint)v % (PGSIZE << order) || v < end || V2P(v) >= PHYSTOP ||
+     order < 0 || order > MAXORDER)
+    panic("kfreen");
+  for(i = 0; i < 1 << order; i++){
+    if(REF(v + i*PGSIZE) != 1)
+      panic("kfreen: ref");
+    REF(v + i*PGSIZE) = 0;
+  }
+
+  // Fill with junk to catch dangling refs.
+  memset(v, 1, PGSIZE << order);
+
+  if(kmem.use_lock)
+    acquire(&kmem.lock);
+  buddyfree(v, order);
+  if(kmem.use_lock)
+    release(&kmem.lock);
+}
+
+// Check at boot that kallocn() splits larger blocks and that
+// kfreen() merges them back.  For each order below MAXORDER,
+// take every free block of that order and then one more,
+// which must be split off a larger block and leave its buddy
+// free.  Freeing them all must give back the free blocks we
+// started with.  Panics if not.
+void
+kalloctest(void)
+{
+  struct vmstat a, b;
+  char *v, *held;
+  int k, n;
+
+  kallocstat(&a);
+  held = 0;
+  for(k = 0; k < MAXORDER; k++){
+    kallocstat(&b);
+    for(n = b.freeblocks[k]; n >= 0; n--){
+      if((v = kallocn(k)) == 0)
+        panic("kalloctest: out of memory");
+      if(V2P(v) % (PGSIZE << k))
+        panic("kalloctest: alignment");
+      // Chain the blocks through their first words.
+      ((char**)v)[0] = held;
+      ((int*)v)[1] = k;
+      held = v;
+    }
+    kallocstat(&b);
+    if(b.freeblocks[k] != 1)
+      panic("kalloctest: split");
+  }
+  while((v = held) != 0){
+    held = ((char**)v)[0];
+    kfreen(v, ((int*)v)[1]);
+  }
+  kallocstat(&b);
+  if(b.freepages != a.freepages)
+    panic("kalloctest: pages lost");
+  for(k = 0; k < NORDER; k++)
+    if(b.freeblocks[k] != a.freeblocks[k])
+      panic("kalloctest: merge");
 }
 
 //PAGEBREAK: 21
-// Free the page of physical memory pointed at by v,
-// which normally should have been returned by a
-// call to kalloc().  (The exception is when
-// initializing the allocator; see kinit above.)
+// Drop a reference to the page of physical memory pointed
+// at by v, which normally should have been returned by a
+// call to kalloc(), and free it if that was the last one.
+// (The exception is when initializing the allocator; see
+// kinit above.)
 void
 kfree(char *v)
 {
+  struct magazine *m;
   struct run *r;
+  int i;
 
   if((uint)v % PGSIZE || v < end || V2P(v) >= PHYSTOP)
     panic("kfree");
 
+  if(REF(v) == 0)
+    panic("kfree: free page");
+  if(__sync_sub_and_fetch(&REF(v), 1) > 0)
+    return;
+
   // Fill with junk to catch dangling refs.
   memset(v, 1, PGSIZE);
 
-  if(kmem.use_lock)
-    acquire(&kmem.lock);
+  if(!kmem.use_lock){
+    buddyfree(v, 0);
+    return;
+  }
+
+  pushcli();
+  m = &kmem.mag[cpu - cpus];
   r = (struct run*)v;
-  r->next = kmem.freelist;
-  kmem.freelist = r;
-  if(kmem.use_lock)
+  r->next = m->freelist;
+  m->freelist = r;
+  if(++m->n == MAGSIZE){
+    // Hand MAGBATCH pages back to kmem in one go.
+    acquire(&kmem.lock);
+    for(i = 0; i < MAGBATCH; i++){
+      r = m->freelist;
+      m->freelist = r->next;
+      buddyfree((char*)r, 0);
+    }
     release(&kmem.lock);
+    m->n -= MAGBATCH;
+    m->drains++;
+  }
+  popcli();
 }
 
 // Allocate one 4096-byte page of physical memory.
@@ -82,15 +311,75 @@ kfree(char *v)
 char*
 kalloc(void)
 {
+  struct magazine *m;
   struct run *r;
+  char *v;
+  int i;
 
-  if(kmem.use_lock)
+  if(!kmem.use_lock){
+    if((v = buddyalloc(0)) != 0)
+      REF(v) = 1;
+    return v;
+  }
+
+  pushcli();
+  m = &kmem.mag[cpu - cpus];
+  if(m->n == 0){
+    // Refill with up to MAGBATCH pages in one go.
     acquire(&kmem.lock);
-  r = kmem.freelist;
-  if(r)
-    kmem.freelist = r->next;
-  if(kmem.use_lock)
+    for(i = 0; i < MAGBATCH && (v = buddyalloc(0)) != 0; i++){
+      r = (struct run*)v;
+      r->next = m->freelist;
+      m->freelist = r;
+    }
     release(&kmem.lock);
+    m->n = i;
+    m->refills++;
+  } else
+    m->hits++;
+  if((r = m->freelist) != 0){
+    m->freelist = r->next;
+    m->n--;
+    REF(r) = 1;
+  }
+  popcli();
   return (char*)r;
 }
 
+// Add a reference to the allocated page at v.
+void
+kdup(char *v)
+{
+  if(REF(v) == 0)
+    panic("kdup");
+  __sync_fetch_and_add(&REF(v), 1);
+}
+
+// Number of references to the page at v.
+int
+krefs(char *v)
+{
+  return REF(v);
+}
+
+// Copy out the allocator counters, summed over CPUs.  Read
+// without locks, so they may be slightly stale.
+void
+kallocstat(struct vmstat *st)
+{
+  struct magazine *m;
+  int k;
+
+  st->freepages = kmem.nfree;
+  st->kallochits = st->kallocrefills = st->kfreedrains = 0;
+  for(m = kmem.mag; m < &kmem.mag[ncpu]; m++){
+    st->freepages += m->n;
+    st->kallochits += m->hits;
+    st->kallocrefills += m->refills;
+    st->kfreedrains += m->drains;
+  }
+  st->kmemacquires = kmem.lock.nacquire;
+  st->kmemcontended = kmem.lock.ncontend;
+  for(k = 0; k < NORDER; k++)
+    st->freeblocks[k] = kmem.nblock[k];
+}
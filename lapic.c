@@ -9,6 +9,7 @@
 #include "traps.h"
 #include "mmu.h"
 #include "x86.h"
+#include "spinlock.h"
 #include "proc.h"  // ncpu
 
 // Local APIC registers, divided by 4 for use as uint[] indices.
@@ -52,22 +53,37 @@ lapicw(int index, int value)
 }
 //PAGEBREAK!
 
+static uint lapickhz;  // Timer counts per millisecond
+
 void
 lapicinit(void)
 {
+  uint64 t0;
+
   if(!lapic)
     return;
 
   // Enable local APIC; set spurious interrupt vector.
   lapicw(SVR, ENABLE | (T_IRQ0 + IRQ_SPURIOUS));
 
-  // The timer repeatedly counts down at bus frequency
-  // from lapic[TICR] and then issues an interrupt.
-  // If xv6 cared more about precise timekeeping,
-  // TICR would be calibrated using an external time source.
+  // The timer counts down once at bus frequency from
+  // lapic[TICR] and then issues an interrupt; lapicarm()
+  // sets it going again for the next time anyone cares about.
+  // The boot CPU first counts bus cycles over 10ms of the TSC,
+  // which tsccalibrate() timed against the PIT.
   lapicw(TDCR, X1);
-  lapicw(TIMER, PERIODIC | (T_IRQ0 + IRQ_TIMER));
-  lapicw(TICR, 10000000);
+  if(lapickhz == 0){
+    lapicw(TIMER, MASKED | (T_IRQ0 + IRQ_TIMER));
+    lapicw(TICR, 0xFFFFFFFF);
+    t0 = rdtsc();
+    while(rdtsc() - t0 < (uint64)tsckhz * 10)
+      ;
+    lapickhz = (0xFFFFFFFF - lapic[TCCR]) / 10;
+    if(lapickhz == 0)
+      lapickhz = 1;
+  }
+  lapicw(TIMER, T_IRQ0 + IRQ_TIMER);
+  lapicw(TICR, divl((uint64)lapickhz * 1000, hz, 0));
 
   // Disable logical interrupt lines.
   lapicw(LINT0, MASKED);
@@ -98,6 +114,28 @@ lapicinit(void)
   lapicw(TPR, 0);
 }
 
+// Interrupt this CPU once, when the TSC reaches due (or soon,
+// if it has), but no later than MAXIDLE ms from now.
+void
+lapicarm(uint64 due)
+{
+  uint64 d, now;
+  uint n;
+
+  if(!lapic)
+    return;
+  now = rdtsc();
+  d = due - now;
+  if((long long)d <= 0)
+    n = 1;
+  else {
+    if(d > (uint64)MAXIDLE * tsckhz)
+      d = (uint64)MAXIDLE * tsckhz;
+    n = divl(d * lapickhz, tsckhz, 0) + 1;
+  }
+  lapicw(TICR, n);
+}
+
 int
 cpunum(void)
 {
@@ -134,6 +172,19 @@ lapiceoi(void)
     lapicw(EOI, 0);
 }
 
+// Send interrupt vector to the CPU with local APIC id apicid.
+// Caller must have interrupts disabled.
+void
+lapicipi(int apicid, int vector)
+{
+  if(!lapic)
+    return;
+  lapicw(ICRHI, apicid<<24);
+  lapicw(ICRLO, FIXED | ASSERT | vector);
+  while(lapic[ICRLO] & DELIVS)
+    ;
+}
+
 // Spin for a given number of microseconds.
 // On real hardware would want to tune this dynamically.
 void
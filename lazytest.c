@@ -0,0 +1,106 @@
+// Demand-zero heap tests: sbrk() reserves address space without
+// memory, pages appear zeroed as they are touched, system calls
+// can read and write untouched heap, fork() shares only what is
+// mapped, and shrinking gives the memory back.  Prints our vsz
+// and rss along the way, as ps shows them.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "proc_type.h"
+
+#define MB (1024 * 1024)
+
+void
+fail(char *what)
+{
+  printf(1, "lazytest: %s FAILED\n", what);
+  exit();
+}
+
+// Our own vsz and rss in kilobytes.
+void
+self(uint *vsz, uint *rss)
+{
+  struct ps_info info;
+
+  info.start = 0;
+  ps_inside(getpid(), &info);
+  if(info.arr_len != 1)
+    fail("ps_inside");
+  *vsz = info.arr[0].vsz;
+  *rss = info.arr[0].rss;
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct vmstat v0, v1;
+  uint vsz0, rss0, vsz, rss;
+  int fds[2], i, pid;
+  char *a, buf[8];
+
+  self(&vsz0, &rss0);
+  getvmstat(&v0);
+  a = sbrk(32 * MB);
+  if(a == (char*)-1)
+    fail("sbrk");
+  getvmstat(&v1);
+  self(&vsz, &rss);
+  printf(1, "lazytest: sbrk 32M: vsz %dK rss %dK (was %dK, %dK)\n",
+         vsz, rss, vsz0, rss0);
+  if(vsz < vsz0 + 32 * 1024 || rss != rss0 || v1.lazypages != v0.lazypages)
+    fail("sbrk allocated memory");
+
+  // Touch every 16th page: each reads zero and costs one page.
+  for(i = 0; i < 32 * MB; i += 16 * 4096){
+    if(a[i] != 0)
+      fail("page not zeroed");
+    a[i] = 1;
+  }
+  getvmstat(&v1);
+  self(&vsz, &rss);
+  printf(1, "lazytest: touched 512 pages: rss %dK, %d pages mapped\n",
+         rss, v1.lazypages - v0.lazypages);
+  if(v1.lazypages - v0.lazypages != 512 || rss != rss0 + 512 * 4)
+    fail("touch");
+
+  // The kernel writes to and reads from untouched heap.
+  if(pipe(fds) < 0)
+    fail("pipe");
+  if(write(fds[1], "lazy", 5) != 5 || read(fds[0], a + 4096, 5) != 5)
+    fail("read into untouched heap");
+  if(strcmp(a + 4096, "lazy") != 0)
+    fail("read data");
+  if(write(fds[1], a + 2 * 4096, 8) != 8 || read(fds[0], buf, 8) != 8)
+    fail("write from untouched heap");
+  for(i = 0; i < 8; i++)
+    if(buf[i] != 0)
+      fail("write data");
+  close(fds[0]);
+  close(fds[1]);
+
+  // A child sees the touched pages and gets its own zero pages.
+  if((pid = fork()) == 0){
+    if(a[16 * 4096] != 1 || a[3 * 4096] != 0)
+      fail("child view");
+    a[3 * 4096] = 2;
+    exit();
+  }
+  wait();
+  if(a[3 * 4096] != 0)
+    fail("child write leaked");
+
+  // Shrinking unmaps; growing back gives fresh zero pages.
+  sbrk(-32 * MB);
+  self(&vsz, &rss);
+  if(vsz != vsz0 || rss != rss0)
+    fail("shrink");
+  a = sbrk(32 * MB);
+  if(a[0] != 0 || a[16 * 4096] != 0)
+    fail("page not zeroed after shrink");
+  sbrk(-32 * MB);
+
+  printf(1, "lazytest ok\n");
+  exit();
+}
@@ -0,0 +1,140 @@
+// Multi-core lock contention benchmark.
+// Runs, one at a time, three workloads with W workers per
+// CPU for a fixed wall-clock time:
+//  - getpid: a syscall that takes no scheduler lock;
+//  - fork: fork() a child that exits at once, and wait();
+//  - pipe: pairs bouncing a byte through two pipes, so every
+//    hop is a sleep() and a wakeup();
+// and reports operations per second and, for each family of
+// scheduler locks (see getlockstat()), how often acquiring it
+// had to wait.  Run it on kernels with different locking to
+// compare them.
+//
+// usage: lockbench [workers-per-cpu [ms]]
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "proc_type.h"
+#include "x86.h"
+
+enum { GETPID, FORK, PIPE, NTEST };
+char *names[NTEST] = { "getpid", "fork", "pipe" };
+
+uint64 end;
+
+int
+worker(int test)
+{
+  int n, pid, a[2], b[2];
+  char c;
+
+  n = 0;
+  switch(test){
+  case GETPID:
+    while(rdtsc() < end){
+      getpid();
+      n++;
+    }
+    break;
+  case FORK:
+    while(rdtsc() < end){
+      if((pid = fork()) < 0)
+        break;
+      if(pid == 0)
+        exit();
+      wait();
+      n++;
+    }
+    break;
+  case PIPE:
+    if(pipe(a) < 0 || pipe(b) < 0)
+      break;
+    if((pid = fork()) < 0)
+      break;
+    if(pid == 0){
+      // Echo until the other end goes away.
+      close(a[1]);
+      close(b[0]);
+      while(read(a[0], &c, 1) == 1)
+        write(b[1], &c, 1);
+      exit();
+    }
+    close(a[0]);
+    close(b[1]);
+    while(rdtsc() < end){
+      write(a[1], &c, 1);
+      if(read(b[0], &c, 1) != 1)
+        break;
+      n++;
+    }
+    close(a[1]);
+    wait();
+    break;
+  }
+  return n;
+}
+
+void
+run(int test, int nworkers, int ms, uint tsckhz)
+{
+  struct lockstat a[NLOCKSTAT], b[NLOCKSTAT];
+  int i, k, n, nl, total, fds[2];
+
+  if(pipe(fds) < 0){
+    printf(1, "lockbench: pipe failed\n");
+    exit();
+  }
+  getlockstat(a, NLOCKSTAT);
+  end = rdtsc() + (uint64)ms * tsckhz;
+  for(i = 0; i < nworkers; i++){
+    if(fork() == 0){
+      close(fds[0]);
+      n = worker(test);
+      write(fds[1], &n, sizeof(n));
+      exit();
+    }
+  }
+  close(fds[1]);
+  total = 0;
+  while(read(fds[0], &n, sizeof(n)) == sizeof(n))
+    total += n;
+  close(fds[0]);
+  for(i = 0; i < nworkers; i++)
+    wait();
+  nl = getlockstat(b, NLOCKSTAT);
+
+  printf(1, "%s: %d ops/sec\n", names[test],
+         total / ms * 1000 + total % ms * 1000 / ms);
+  for(k = 0; k < nl; k++){
+    b[k].acquires -= a[k].acquires;
+    b[k].contended -= a[k].contended;
+    b[k].spins -= a[k].spins;
+    printf(1, "  %s\t%d acquires, %d contended (%d per 1000), %d spins\n",
+           b[k].name, b[k].acquires, b[k].contended,
+           b[k].acquires ? b[k].contended * 1000 / b[k].acquires : 0,
+           b[k].spins);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct schedstat st;
+  struct schedconf conf;
+  int per, ms, t;
+
+  per = argc > 1 ? atoi(argv[1]) : 2;
+  ms = argc > 2 ? atoi(argv[2]) : 2000;
+  if(per <= 0)
+    per = 1;
+  if(ms <= 0)
+    ms = 1;
+  getschedstat(&st);
+  schedconf(&conf, 0);
+  printf(1, "lockbench: %d cpus, %d workers, %d ms per test\n",
+         st.ncpu, per * st.ncpu, ms);
+  for(t = 0; t < NTEST; t++)
+    run(t, per * st.ncpu, ms, conf.tsckhz);
+  exit();
+}
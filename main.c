@@ -3,6 +3,7 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
 #include "x86.h"
 
@@ -20,6 +21,7 @@ main(void)
   kinit1(end, P2V(4*1024*1024)); // phys page allocator
   kvmalloc();      // kernel page table
   mpinit();        // detect other processors
+  tsccalibrate();  // TSC rate and the clock
   lapicinit();     // interrupt controller
   seginit();       // segment descriptors
   picinit();       // another interrupt controller
@@ -27,6 +29,7 @@ main(void)
   consoleinit();   // console hardware
   uartinit();      // serial port
   pinit();         // process table
+  traceinit();     // scheduler trace
   tvinit();        // trap vectors
   binit();         // buffer cache
   fileinit();      // file table
@@ -35,6 +38,7 @@ main(void)
     timerinit();   // uniprocessor timer
   startothers();   // start other processors
   kinit2(P2V(4*1024*1024), P2V(PHYSTOP)); // must come after startothers()
+  kalloctest();    // buddy allocator self-test
   userinit();      // first user process
   mpmain();        // finish this processor's setup
 }
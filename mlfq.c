@@ -0,0 +1,130 @@
+// Multi-level feedback queue scheduling class.
+// A process runs at level p->niceness (0 is most urgent) for
+// up to quantum_us[level] microseconds at a time, measured on
+// the TSC from when it was switched in, so quanta need not be
+// whole ticks; using up the whole slice moves it one level
+// down.  setnice() and the periodic boost in proc.c move it
+// back up.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "proc_type.h"
+#include "sched.h"
+
+// Quanta per level, set by schedconf(); the defaults are the
+// 1, 2, 4 and 8 ticks of a 100Hz clock.
+uint quantum_us[4] = {10000, 20000, 40000, 80000};
+static uint64 quantum_tsc[4];
+
+// Set the quanta, in microseconds.  Called by pinit() once
+// the TSC has been calibrated, and by schedconf().
+void
+mlfq_setquanta(uint *us)
+{
+  int l;
+
+  for(l = 0; l < 4; l++){
+    quantum_us[l] = us[l];
+    quantum_tsc[l] = (uint64)(us[l] / 1000) * tsckhz +
+                     divl((uint64)(us[l] % 1000) * tsckhz, 1000, 0);
+  }
+}
+
+static void
+mlfq_enqueue(struct runq *rq, struct proc *p)
+{
+  enque(rq->mlfq + p->niceness, p);
+  p->qlevel = p->niceness;
+  rq->bitmap |= 1 << p->niceness;
+}
+
+static void
+mlfq_dequeue(struct runq *rq, struct proc *p)
+{
+  deque_proc(rq->mlfq + p->qlevel, p);
+  if(empty(rq->mlfq + p->qlevel))
+    rq->bitmap &= ~(1 << p->qlevel);
+}
+
+// Head of the highest non-empty level: one bit scan.
+static struct proc*
+mlfq_peek(struct runq *rq)
+{
+  if(rq->bitmap == 0)
+    return 0;
+  return front(rq->mlfq + bsf(rq->bitmap));
+}
+
+static struct proc*
+mlfq_pick_next(struct runq *rq)
+{
+  struct proc *p;
+
+  if((p = mlfq_peek(rq)) != 0)
+    mlfq_dequeue(rq, p);
+  return p;
+}
+
+static int
+mlfq_tick(struct proc *p)
+{
+  p->timeslice++;
+  return rdtsc() - p->runstart >= quantum_tsc[p->niceness];
+}
+
+static uint64
+mlfq_slice_end(struct proc *p)
+{
+  return p->runstart + quantum_tsc[p->niceness];
+}
+
+static void
+mlfq_yield(struct proc *p)
+{
+  if(p->lastrun >= quantum_tsc[p->niceness] && p->niceness < 3){
+    p->niceness++;
+    trace(TR_DEMOTE, p, p->niceness);
+  }
+}
+
+static int
+mlfq_preempt(struct proc *running, struct proc *p)
+{
+  return p->niceness < running->niceness;
+}
+
+// Nice values are MLFQ levels, 0..3.
+static int
+mlfq_setnice(struct proc *p, int value)
+{
+  if(value < 0 || value > 3)
+    return -1;
+  p->niceness = value;
+  return 0;
+}
+
+static int
+mlfq_getnice(struct proc *p)
+{
+  return p->niceness;
+}
+
+struct sched_class mlfq_class = {
+  .name = "mlfq",
+  .policy = SCHED_MLFQ,
+  .enqueue = mlfq_enqueue,
+  .dequeue = mlfq_dequeue,
+  .pick_next = mlfq_pick_next,
+  .peek = mlfq_peek,
+  .tick = mlfq_tick,
+  .slice_end = mlfq_slice_end,
+  .yield = mlfq_yield,
+  .preempt = mlfq_preempt,
+  .setnice = mlfq_setnice,
+  .getnice = mlfq_getnice,
+};
@@ -1,14 +1,22 @@
-#define NPROC        64  // maximum number of processes
+#define NPROC      2048  // maximum number of processes
 #define KSTACKSIZE 4096  // size of per-process kernel stack
 #define NCPU          8  // maximum number of CPUs
 #define NOFILE       16  // open files per process
 #define NFILE       100  // open files per system
 #define NINODE       50  // maximum number of active i-nodes
+#define NIPAGE      256  // executable pages cached, see ipage()
+#define NSEG          4  // program segments per process
 #define NDEV         10  // maximum major device number
 #define ROOTDEV       1  // device number of file system root disk
 #define MAXARG       32  // max exec arguments
 #define MAXOPBLOCKS  10  // max # of blocks any FS op writes
 #define LOGSIZE      (MAXOPBLOCKS*3)  // max data blocks in on-disk log
 #define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
-#define FSSIZE       1000  // size of file system in blocks
+#define FSSIZE       4000  // size of file system in blocks
+#define HZ            100  // default timer ticks per second
+#define MAXIDLE       1000 // longest a tickless CPU sleeps, in ms
+#define BOOSTTICKS    100  // default MLFQ priority boost period
+#define NHIST         24  // log2 buckets in scheduler latency histograms
+#define TRACESIZE     2048  // scheduler trace events per CPU
+#define EDFMAXUTIL    900  // cap on summed EDF reservations, per mille of a CPU
 
@@ -0,0 +1,54 @@
+// Pid lookup microbenchmark.
+// Fills the process table with children parked on a pipe,
+// then times 100000 getnice() calls on the newest child, the
+// one a linear scan of the table would find last.
+//
+// usage: pidbench [calls]
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "x86.h"
+
+int
+main(int argc, char *argv[])
+{
+  int fds[2], i, n, calls, pid, last;
+  uint64 t0, t1;
+  char c;
+
+  calls = argc > 1 ? atoi(argv[1]) : 100000;
+  if(calls <= 0)
+    calls = 1;
+  if(pipe(fds) < 0){
+    printf(1, "pidbench: pipe failed\n");
+    exit();
+  }
+  last = getpid();
+  for(n = 0; n < NPROC; n++){
+    pid = fork();
+    if(pid < 0)
+      break;
+    if(pid == 0){
+      close(fds[1]);
+      read(fds[0], &c, 1);
+      exit();
+    }
+    last = pid;
+  }
+  close(fds[0]);
+
+  t0 = rdtsc();
+  for(i = 0; i < calls; i++)
+    getnice(last);
+  t1 = rdtsc();
+
+  close(fds[1]);
+  for(i = 0; i < n; i++)
+    wait();
+
+  printf(1, "pidbench: %d children, %d getnice(%d) calls, %d cycles/call\n",
+         n, calls, last, (uint)(t1 - t0) / calls);
+  exit();
+}
@@ -0,0 +1,56 @@
+// Wakeup-to-run latency benchmark.
+// Two processes bounce a byte across a pair of pipes; every
+// hop is a wakeup of a process that, on a multi-core boot,
+// usually last ran on the other CPU.  Reports the average
+// round trip in cycles and how many reschedule IPIs it took.
+// Run with CPUS=2 or more.
+//
+// usage: pingpong [rounds]
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "x86.h"
+#include "proc_type.h"
+
+int
+main(int argc, char *argv[])
+{
+  int rounds, i, ping[2], pong[2], t0;
+  uint c0, c1;
+  struct schedstat a, b;
+  char c;
+
+  rounds = argc > 1 ? atoi(argv[1]) : 1000;
+  if(pipe(ping) < 0 || pipe(pong) < 0){
+    printf(1, "pingpong: pipe failed\n");
+    exit();
+  }
+
+  if(fork() == 0){
+    for(;;){
+      if(read(ping[0], &c, 1) != 1)
+        exit();
+      write(pong[1], &c, 1);
+    }
+  }
+
+  getschedstat(&a);
+  t0 = uptime();
+  c0 = (uint)rdtsc();
+  for(i = 0; i < rounds; i++){
+    write(ping[1], "x", 1);
+    read(pong[0], &c, 1);
+  }
+  c1 = (uint)rdtsc();
+  getschedstat(&b);
+
+  printf(1, "pingpong: %d cpus, %d rounds in %d ticks, %d cycles/round trip\n",
+         b.ncpu, rounds, uptime() - t0, (c1 - c0) / rounds);
+  printf(1, "  %d reschedule IPIs, %d context switches\n",
+         b.ipis - a.ipis, b.nswitch - a.nswitch);
+
+  close(ping[1]);
+  wait();
+  exit();
+}
@@ -4,37 +4,191 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "x86.h"
-#include "proc.h"
 #include "spinlock.h"
+#include "proc.h"
+#include "traps.h"
 
 // PA #1
 #include "proc_type.h"
+#include "sched.h"
 
-// PA #2
-queue mlfq[4];
-int is_runnable[NPROC];
+// Locking.  p->lock guards p->state, p->chan and p->killed,
+// and is held across swtch() between p and the scheduler, so
+// whoever holds it knows p is not half way on or off a CPU.
+// ptable.lock guards the slot lists, the pid index, parent and
+// child links and the scheduler settings.  Run queues and
+// sleep queues have locks of their own.  Locks are taken in
+// the order: ptable.lock; tickslock or the lock passed to
+// sleep(); a sleep queue; p->lock; a run queue.
 
+// PA #2
+// Per-CPU run queues, see sched.h.  A queued process is only
+// moved with its p->lock and then the queue's lock held.
+struct runq runqs[NCPU];
+
+// Scheduling classes in order of precedence, and the class
+// given to new processes (see setsched()).
+static struct sched_class *classes[] = {
+  &edf_class,
+  &mlfq_class,
+  &stride_class,
+  &rr_class,
+};
+static struct sched_class *sched_default = &mlfq_class;
+
+// Sum of rt_util() over all processes, at most EDFMAXUTIL.
+// Protected by ptable.lock.
+static int edf_util;
+
+// Every boost_period ticks all processes are moved back to
+// level 0 so that demoted work cannot starve.  0 disables.
+int boost_period = BOOSTTICKS;
+
+static void runq_init(struct runq*);
+static int rt_util(struct proc*);
+
+// Process slots are carved out of kernel pages as they are
+// needed, up to NPROC, and never given back.  Every slot stays
+// on the procs list in slot order; UNUSED ones are also on the
+// free list, linked through hnext.
 struct {
   struct spinlock lock;
-  struct proc proc[NPROC];
-} ptable;
+  struct proc *procs;
+  struct proc **tail;          // Where the next slot is linked
+  struct proc *free;
+  int nslot;
+} ptable = { .tail = &ptable.procs };
 
 static struct proc *initproc;
 
+// Sleeping processes, hashed by the channel they sleep on,
+// so wakeup() only looks at processes that may be waiting
+// for it.  Each bucket has its own lock.
+#define NSLEEPQ 64
+static struct sleepq {
+  struct spinlock lock;
+  queue procs;
+} sleepq[NSLEEPQ];
+
+static struct sleepq*
+sleepq_for(void *chan)
+{
+  return &sleepq[((uint)chan * 2654435761U) >> 26];
+}
+
+// Processes from allocproc() until wait() frees them, hashed
+// by pid.  Pids are handed out in sequence, so the low bits
+// spread them evenly.  Protected by ptable.lock.
+#define NPIDHASH 64
+static struct proc *pidhash[NPIDHASH];
+
+static struct proc**
+pidhash_for(int pid)
+{
+  return &pidhash[pid & (NPIDHASH-1)];
+}
+
+static void
+pidhash_insert(struct proc *p)
+{
+  struct proc **h = pidhash_for(p->pid);
+
+  p->hnext = *h;
+  *h = p;
+}
+
+static void
+pidhash_remove(struct proc *p)
+{
+  struct proc **pp;
+
+  for(pp = pidhash_for(p->pid); *pp; pp = &(*pp)->hnext){
+    if(*pp == p){
+      *pp = p->hnext;
+      p->hnext = 0;
+      return;
+    }
+  }
+  panic("pidhash_remove");
+}
+
+// The process with the given pid, or 0 if there is none.
+// Caller must hold ptable.lock.
+static struct proc*
+findproc(int pid)
+{
+  struct proc *p;
+
+  for(p = *pidhash_for(pid); p; p = p->hnext)
+    if(p->pid == pid)
+      return p;
+  return 0;
+}
+
+struct schedstat schedstat;
+
 int nextpid = 1;
 extern void forkret(void);
 extern void trapret(void);
 
-static void wakeup1(void *chan);
-
 void
 pinit(void)
 {
+  int i;
+
   initlock(&ptable.lock, "ptable");
+  if(sizeof(struct proc) > PGSIZE)
+    panic("pinit: struct proc");
+  for(i = 0; i < NCPU; i++)
+    runq_init(runqs + i);
+  for(i = 0; i < NSLEEPQ; i++){
+    initlock(&sleepq[i].lock, "sleepq");
+    init_queue(&sleepq[i].procs);
+  }
+  mlfq_setquanta(quantum_us);
+}
+
+// Carve a page into process slots and put them on the free
+// list, lowest slot first.  Returns -1 if the table is full or
+// memory is.  Caller must hold ptable.lock.
+static int
+growptable(void)
+{
+  struct proc *p, *mem;
+  int i, n;
+
+  n = PGSIZE / sizeof(struct proc);
+  if(n > NPROC - ptable.nslot)
+    n = NPROC - ptable.nslot;
+  if(n <= 0 || (mem = (struct proc*)kalloc()) == 0)
+    return -1;
+  memset(mem, 0, PGSIZE);
+  for(i = 0; i < n; i++){
+    p = mem + i;
+    initlock(&p->lock, "proc");
+    p->slot = ptable.nslot++;
+    *ptable.tail = p;
+    ptable.tail = &p->pnext;
+  }
+  for(i = n - 1; i >= 0; i--){
+    mem[i].hnext = ptable.free;
+    ptable.free = mem + i;
+  }
+  return 0;
+}
+
+// Put p, whose pid is already unhashed, back on the free list.
+// Caller must hold ptable.lock.
+static void
+freeslot(struct proc *p)
+{
+  p->state = UNUSED;
+  p->hnext = ptable.free;
+  ptable.free = p;
 }
 
 //PAGEBREAK: 32
-// Look in the process table for an UNUSED proc.
+// Take an UNUSED proc off the free list.
 // If found, change state to EMBRYO and initialize
 // state required to run in the kernel.
 // Otherwise return 0.
@@ -43,25 +197,55 @@ allocproc(void)
 {
   struct proc *p;
   char *sp;
+  int pid;
 
+  pid = __sync_fetch_and_add(&nextpid, 1);
   acquire(&ptable.lock);
 
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-    if(p->state == UNUSED)
-      goto found;
-
-  release(&ptable.lock);
-  return 0;
+  if(ptable.free == 0 && growptable() < 0){
+    release(&ptable.lock);
+    return 0;
+  }
+  p = ptable.free;
+  ptable.free = p->hnext;
+  p->hnext = 0;
 
-found:
   p->state = EMBRYO;
-  p->pid = nextpid++;
+  p->pid = pid;
+  pidhash_insert(p);
+  p->children = 0;
+  p->sibling = 0;
+  // Scheduler state is read by getpinfo() and friends under
+  // ptable.lock, so set it up before letting go.
+  p->niceness = 0;
+  p->ticks = 0;
+  p->timeslice = 0;
+  p->enqtick = 0;
+  p->waitticks = 0;
+  p->maxwait = 0;
+  memset(p->rundelay, 0, sizeof(p->rundelay));
+  memset(p->inqueue, 0, sizeof(p->inqueue));
+  p->utsc = 0;
+  p->stsc = 0;
+  p->qnext = 0;
+  p->qprev = 0;
+  p->qlevel = -1;
+  p->cpuid = -1;
+  p->tqidx = -1;
+  p->sclass = sched_default;
+  p->snice = STRIDE_NICE_DEFAULT;
+  p->pass = 0;
+  p->rt_runtime = 0;
+  p->rt_period = 0;
 
   release(&ptable.lock);
 
   // Allocate kernel stack.
   if((p->kstack = kalloc()) == 0){
-    p->state = UNUSED;
+    acquire(&ptable.lock);
+    pidhash_remove(p);
+    freeslot(p);
+    release(&ptable.lock);
     return 0;
   }
   sp = p->kstack + KSTACKSIZE;
@@ -79,9 +263,6 @@ found:
   p->context = (struct context*)sp;
   memset(p->context, 0, sizeof *p->context);
   p->context->eip = (uint)forkret;
-  p->niceness = 0;
-  p->ticks = 0;
-  p->timeslice = 0;
 
   return p;
 }
@@ -117,11 +298,12 @@ userinit(void)
   // run this process. the acquire forces the above
   // writes to be visible, and the lock is also needed
   // because the assignment might not be atomic.
-  acquire(&ptable.lock);
+  acquire(&p->lock);
 
   p->state = RUNNABLE;
+  runq_enque(p);
 
-  release(&ptable.lock);
+  release(&p->lock);
   
 }
 
@@ -134,8 +316,11 @@ growproc(int n)
 
   sz = proc->sz;
   if(n > 0){
-    if((sz = allocuvm(proc->pgdir, sz, sz + n)) == 0)
+    // Only reserve the address space; the page fault handler
+    // maps zeroed pages as they are touched.
+    if(sz + n >= KERNBASE)
       return -1;
+    sz += n;
   } else if(n < 0){
     if((sz = deallocuvm(proc->pgdir, sz, sz + n)) == 0)
       return -1;
@@ -163,11 +348,13 @@ fork(void)
   if((np->pgdir = copyuvm(proc->pgdir, proc->sz)) == 0){
     kfree(np->kstack);
     np->kstack = 0;
-    np->state = UNUSED;
+    acquire(&ptable.lock);
+    pidhash_remove(np);
+    freeslot(np);
+    release(&ptable.lock);
     return -1;
   }
   np->sz = proc->sz;
-  np->parent = proc;
   *np->tf = *proc->tf;
 
   // Clear %eax so that fork returns 0 in the child.
@@ -177,25 +364,28 @@ fork(void)
     if(proc->ofile[i])
       np->ofile[i] = filedup(proc->ofile[i]);
   np->cwd = idup(proc->cwd);
+  if(proc->exe)
+    np->exe = iexecdup(proc->exe);
+  memmove(np->seg, proc->seg, sizeof(proc->seg));
+  np->nseg = proc->nseg;
 
   safestrcpy(np->name, proc->name, sizeof(proc->name));
 
   pid = np->pid;
 
   acquire(&ptable.lock);
+  np->parent = proc;
+  np->sibling = proc->children;
+  proc->children = np;
+  release(&ptable.lock);
 
+  // The child waits its turn unless it outranks the parent,
+  // in which case runq_kick() preempts on the way out.
+  acquire(&np->lock);
   np->state = RUNNABLE;
-  proc->state = RUNNABLE;
-  
-  is_runnable[np - ptable.proc] = 1;
-  enque(mlfq + 0, np - ptable.proc);
-//  cprintf("fork(): %s, pid: %d, idx: %d runnable?: %d, nice: %d\n", 
-//  proc->name, proc->pid, proc - ptable.proc, proc->state == RUNNABLE,
-//  proc->niceness);
-  
-  sched();
-
-  release(&ptable.lock);
+  np->cpuid = cpu - cpus;
+  runq_enque(np);
+  release(&np->lock);
 
   return pid;
 }
@@ -224,23 +414,43 @@ exit(void)
   iput(proc->cwd);
   end_op();
   proc->cwd = 0;
+  if(proc->exe){
+    begin_op();
+    iexecput(proc->exe);
+    end_op();
+    proc->exe = 0;
+  }
 
   acquire(&ptable.lock);
 
+  // Give back any EDF reservation.
+  edf_util -= rt_util(proc);
+  proc->rt_runtime = 0;
+
   // Parent might be sleeping in wait().
-  wakeup1(proc->parent);
+  wakeup(proc->parent);
 
   // Pass abandoned children to init.
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->parent == proc){
+  if((p = proc->children) != 0){
+    for(;;){
       p->parent = initproc;
       if(p->state == ZOMBIE)
-        wakeup1(initproc);
+        wakeup(initproc);
+      if(p->sibling == 0)
+        break;
+      p = p->sibling;
     }
+    p->sibling = initproc->children;
+    initproc->children = proc->children;
+    proc->children = 0;
   }
 
-  // Jump into the scheduler, never to return.
+  // Jump into the scheduler, never to return.  wait() sees
+  // ZOMBIE under ptable.lock, and then waits for p->lock so
+  // as not to free us while we are still on our stack.
+  acquire(&proc->lock);
   proc->state = ZOMBIE;
+  release(&ptable.lock);
   sched();
   panic("zombie exit");
 }
@@ -250,28 +460,43 @@ exit(void)
 int
 wait(void)
 {
-  struct proc *p;
-  int havekids, pid;
+  return waitpid(-1, 0);
+}
+
+// Wait for the child with the given pid, or any child if pid
+// is -1, to exit, and return its pid.  With WNOHANG, return 0
+// instead of sleeping if it has not exited yet.  Return -1 if
+// there is no such child.
+int
+waitpid(int pid, int options)
+{
+  struct proc *p, **pp;
+  int havekids;
 
   acquire(&ptable.lock);
   for(;;){
-    // Scan through table looking for exited children.
+    // Look through our children for exited ones.
     havekids = 0;
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->parent != proc)
+    for(pp = &proc->children; (p = *pp) != 0; pp = &p->sibling){
+      if(pid != -1 && p->pid != pid)
         continue;
       havekids = 1;
       if(p->state == ZOMBIE){
-        // Found one.
+        // Found one.  Wait for it to be off its CPU.
+        acquire(&p->lock);
+        release(&p->lock);
+        *pp = p->sibling;
         pid = p->pid;
         kfree(p->kstack);
         p->kstack = 0;
         freevm(p->pgdir);
+        pidhash_remove(p);
         p->pid = 0;
         p->parent = 0;
+        p->sibling = 0;
         p->name[0] = 0;
         p->killed = 0;
-        p->state = UNUSED;
+        freeslot(p);
         release(&ptable.lock);
         return pid;
       }
@@ -282,8 +507,12 @@ wait(void)
       release(&ptable.lock);
       return -1;
     }
+    if(options & WNOHANG){
+      release(&ptable.lock);
+      return 0;
+    }
 
-    // Wait for children to exit.  (See wakeup1 call in proc_exit.)
+    // Wait for children to exit.  (See wakeup call in exit.)
     sleep(proc, &ptable.lock);  //DOC: wait-sleep
   }
 }
@@ -300,259 +529,587 @@ wait(void)
 // PA #2
 void init_queue(queue* q)
 {
-	q->front = 0;
-	q->rear = 0;
+	q->head = 0;
+	q->tail = 0;
 }
 
-void enque(queue* q, int pid)
+void enque(queue* q, struct proc* p)
 {
-	if (q->front == (q->rear + 1) % (NPROC + 1)) {
-		return;
+	p->qnext = 0;
+	p->qprev = q->tail;
+	if (q->tail)
+		q->tail->qnext = p;
+	else
+		q->head = p;
+	q->tail = p;
+}
+
+// Insert p just ahead of pos, which must be on q.
+void enque_before(queue* q, struct proc* pos, struct proc* p)
+{
+	p->qnext = pos;
+	p->qprev = pos->qprev;
+	if (pos->qprev)
+		pos->qprev->qnext = p;
+	else
+		q->head = p;
+	pos->qprev = p;
+}
+
+struct proc* deque(queue* q)
+{
+	struct proc *p = q->head;
+
+	if (p)
+		deque_proc(q, p);
+	return p;
+}
+
+void deque_proc(queue* q, struct proc* p)
+{
+	if (p->qprev)
+		p->qprev->qnext = p->qnext;
+	else
+		q->head = p->qnext;
+	if (p->qnext)
+		p->qnext->qprev = p->qprev;
+	else
+		q->tail = p->qprev;
+	p->qnext = 0;
+	p->qprev = 0;
+}
+
+int empty(queue* q)
+{
+	return q->head == 0;
+}
+
+struct proc* front(queue* q)
+{
+	return q->head;
+}
+
+// Precedence of class c: lower runs first.
+static int class_rank(struct sched_class* c)
+{
+	int i;
+
+	for (i = 0; i < NELEM(classes); i++)
+		if (classes[i] == c)
+			return i;
+	panic("class_rank");
+}
+
+// Should p, just queued, take the CPU from running?
+static int sched_preempts(struct proc* running, struct proc* p)
+{
+	if (running->sclass != p->sclass)
+		return class_rank(p->sclass) < class_rank(running->sclass);
+	return p->sclass->preempt(running, p);
+}
+
+// Does anything queued on this CPU outrank curr, running here?
+static int runq_outranked(struct proc* curr)
+{
+	struct runq *rq = runqs + (cpu - cpus);
+	struct proc *p;
+	int i, r = 0;
+
+	acquire(&rq->lock);
+	for (i = 0; i < NELEM(classes); i++) {
+		if ((p = classes[i]->peek(rq)) != 0) {
+			r = sched_preempts(curr, p);
+			break;
+		}
 	}
-	q->pids[(q->rear)++] = pid;
-	q->rear %= (NPROC + 1);
+	release(&rq->lock);
+	return r;
 }
 
-int deque(queue* q)
+static void send_resched(int c)
 {
-	int ret;
-	if (q->front == q->rear) {
-		return -1;
+	__sync_fetch_and_add(&schedstat.ipis, 1);
+	lapicipi(cpus[c].apicid, T_RESCHED);
+}
+
+// p was just queued for CPU c.  Rather than let it wait for
+// someone's next timer tick, interrupt c if it is idle or
+// running something less urgent; if c is busy with equally
+// or more urgent work, wake an idle CPU to steal p instead.
+// What other CPUs run is read without locks, as a hint.
+static void runq_kick(int c, struct proc* p)
+{
+	struct proc *running;
+	int self, i;
+
+	self = cpu - cpus;
+	if (c == self) {
+		// Preempt on the way out of the current trap.
+		if (proc && sched_preempts(proc, p))
+			cpu->needresched = 1;
+		return;
+	}
+	running = cpus[c].proc;
+	if (running == 0 || sched_preempts(running, p)) {
+		cpus[c].needresched = 1;
+		send_resched(c);
+		return;
+	}
+	for (i = 0; i < ncpu; i++) {
+		if (i != self && i != c && cpus[i].proc == 0) {
+			send_resched(i);
+			return;
+		}
 	}
-	ret = q->pids[(q->front)++];
-	q->front %= (NPROC + 1);
-	return ret;
 }
 
-int rear_deque(queue* q)
+static void runq_init(struct runq* rq)
 {
-	int ret;
-	if (q->front == q->rear) {
-		return -1;
+	initlock(&rq->lock, "runq");
+	for (int i = 0; i < 4; i++)
+		init_queue(rq->mlfq + i);
+	rq->bitmap = 0;
+	init_queue(&rq->rr);
+	init_queue(&rq->stride);
+	rq->stride_pass = 0;
+	init_queue(&rq->edf);
+	init_queue(&rq->edf_throttled);
+	rq->nqueued = 0;
+	rq->nparked = 0;
+}
+
+// Cycle accounting.  p->acctsc marks the start of the
+// stretch not yet charged; trap() charges it to user time on
+// entry from user space and to kernel time on the way back,
+// and switch_to() charges time in the kernel around swtch().
+void acct_user(struct proc* p)
+{
+	uint64 now = rdtsc();
+
+	p->utsc += now - p->acctsc;
+	p->acctsc = now;
+}
+
+void acct_kernel(struct proc* p)
+{
+	uint64 now = rdtsc();
+
+	p->stsc += now - p->acctsc;
+	p->acctsc = now;
+}
+
+// Count a delay of cycles in log2 histogram h, see pinfo.
+static void hist_add(uint* h, uint64 cycles)
+{
+	uint b;
+
+	if (cycles >> 42)
+		b = NHIST - 1;
+	else if ((cycles >> 10) == 0)
+		b = 0;
+	else
+		b = bsr((uint)(cycles >> 10)) + 1;
+	if (b >= NHIST)
+		b = NHIST - 1;
+	h[b]++;
+}
+
+// Queue p, under its class, on the run queue of the CPU it
+// last ran on (or this CPU, if it has never run).
+// Caller must hold p->lock and p must be RUNNABLE.
+void runq_enque(struct proc* p)
+{
+	struct runq *rq;
+
+	if (p->qlevel >= 0)
+		panic("runq_enque");
+	if (p->cpuid < 0)
+		p->cpuid = cpu - cpus;
+	rq = runqs + p->cpuid;
+	acquire(&rq->lock);
+	p->sclass->enqueue(rq, p);
+	p->enqtick = ticks;
+	p->enqtsc = p->lvltsc = rdtsc();
+	p->enqlevel = p->qlevel;
+	rq->nqueued++;
+	release(&rq->lock);
+	trace(TR_ENQUEUE, p, p->qlevel);
+	runq_kick(p->cpuid, p);
+}
+
+// Remove p from whatever run queue it is on.  Returns 0 if
+// it was on none: a scheduler may take p off its queue
+// without p->lock, and then waits for p->lock to run it.
+// Caller must hold p->lock.
+int runq_deque(struct proc* p)
+{
+	struct runq *rq;
+
+	if (p->qlevel < 0)
+		return 0;
+	rq = runqs + p->cpuid;
+	acquire(&rq->lock);
+	if (p->qlevel < 0) {
+		release(&rq->lock);
+		return 0;
 	}
-	ret = q->pids[--(q->rear)];
-	q->rear = (q->rear + NPROC + 1) % (NPROC + 1);
-	return ret;
+	hist_add(p->inqueue[p->enqlevel], rdtsc() - p->lvltsc);
+	p->sclass->dequeue(rq, p);
+	p->qlevel = -1;
+	rq->nqueued--;
+	release(&rq->lock);
+	return 1;
 }
 
-int deque_by_idx(queue* q, int idx)
+// Take p off its queue, let change(p, arg) modify it, and
+// queue it again, keeping its place in time: its wait keeps
+// counting from when it was first enqueued.  Returns what
+// change returned.
+// Caller must hold p->lock.
+static int runq_requeue(struct proc* p, int (*change)(struct proc*, int), int arg)
 {
-	int ret;
-	int index = -1;
-	for (int i = q->front; i != q->rear; i = (i + 1)%(NPROC + 1)) {
-		if (q->pids[i] == idx) {
-			index = i;
-			break;
+	uint enqtick;
+	uint64 enqtsc;
+	int r;
+
+	enqtick = p->enqtick;
+	enqtsc = p->enqtsc;
+	if (!runq_deque(p))
+		return change(p, arg);
+	r = change(p, arg);
+	runq_enque(p);
+	p->enqtick = enqtick;
+	p->enqtsc = enqtsc;
+	return r;
+}
+
+static int set_niceness(struct proc* p, int value)
+{
+	return p->sclass->setnice(p, value);
+}
+
+static int set_class(struct proc* p, int policy)
+{
+	int i;
+
+	for (i = 0; i < NELEM(classes); i++) {
+		if (classes[i]->policy == policy) {
+			p->sclass = classes[i];
+			return 0;
 		}
 	}
-	if (index == -1) {
+	return -1;
+}
+
+// Priority boost: move every MLFQ process back to level 0.
+void mlfq_boost(void)
+{
+	struct proc *p;
+
+	acquire(&ptable.lock);
+	for (p = ptable.procs; p; p = p->pnext) {
+		if (p->state == UNUSED)
+			continue;
+		acquire(&p->lock);
+		if (p->sclass == &mlfq_class && p->niceness != 0)
+			runq_requeue(p, set_niceness, 0);
+		release(&p->lock);
+	}
+	release(&ptable.lock);
+}
+
+// Set the boost period in ticks (0 disables boosting) and
+// return the previous one.  A negative period only reads it.
+int setboost(int period)
+{
+	int old;
+
+	acquire(&ptable.lock);
+	old = boost_period;
+	if (period >= 0)
+		boost_period = period;
+	release(&ptable.lock);
+	return old;
+}
+
+// Switch every process under the default class, and all new
+// processes, to the class for policy, moving queued processes
+// over.  Returns the previous default policy, or -1 if policy
+// is unknown.  A negative policy only reads it.
+int setsched(int policy)
+{
+	struct sched_class *old, *new = 0;
+	struct proc *p;
+	int i;
+
+	acquire(&ptable.lock);
+	old = sched_default;
+	if (policy < 0) {
+		release(&ptable.lock);
+		return old->policy;
+	}
+	for (i = 0; i < NELEM(classes); i++)
+		if (classes[i]->policy == policy)
+			new = classes[i];
+	// EDF needs a reservation per process; see reserve().
+	if (new == 0 || new == &edf_class) {
+		release(&ptable.lock);
 		return -1;
 	}
-	ret = idx;
-	
-	for (int i = index; (i + 1)%(NPROC + 1) != q->rear; i = (i + 1)%(NPROC + 1)) {
-		q->pids[i] = q->pids[(i + 1)%(NPROC + 1)];
+	for (p = ptable.procs; p; p = p->pnext) {
+		if (p->state == UNUSED)
+			continue;
+		acquire(&p->lock);
+		if (p->sclass == old)
+			runq_requeue(p, set_class, policy);
+		release(&p->lock);
 	}
-	q->rear = (q->rear - 1 + NPROC + 1) % (NPROC + 1);
-	
-	return ret;
+	sched_default = new;
+	release(&ptable.lock);
+	return old->policy;
 }
 
-int empty(queue* q)
+// CPU share of p's EDF reservation, per mille, rounded up.
+static int rt_util(struct proc* p)
 {
-	return q->front == q->rear;
+	if (p->rt_runtime == 0)
+		return 0;
+	return (p->rt_runtime * 1000 + p->rt_period - 1) / p->rt_period;
 }
 
-int front(queue* q)
+static int set_rt_class(struct proc* p, int reserved)
 {
-	return q->pids[q->front];
+	p->sclass = reserved ? &edf_class : sched_default;
+	return 0;
 }
 
-void print_queue(queue* q)
+// Reserve runtime ticks in every period ticks for process pid
+// and move it to the EDF class, or, if runtime is 0, drop its
+// reservation and return it to the default class.  Admission
+// control refuses reservations that would add up to more than
+// EDFMAXUTIL per mille of one CPU, so that every deadline can
+// be met even if all reserved processes share a CPU.
+// Returns 0, or -1 if refused or pid does not exist.
+int reserve(int pid, int runtime, int period)
 {
-	for (int i = q->front; i != q->rear; i = (i + 1)%(NPROC + 1)){
-		cprintf("%d=%s ", q->pids[i], ptable.proc[q->pids[i]].name);
+	struct proc *p;
+	int u;
+
+	if (runtime < 0 || (runtime > 0 && (period <= 0 || runtime > period)))
+		return -1;
+	u = runtime > 0 ? (runtime * 1000 + period - 1) / period : 0;
+
+	acquire(&ptable.lock);
+	p = findproc(pid);
+	if (p == 0 || p->state == ZOMBIE || edf_util - rt_util(p) + u > EDFMAXUTIL) {
+		release(&ptable.lock);
+		return -1;
 	}
-	cprintf("%s %d\n", empty(q) ? "empty":"filled", empty(q) ? 0 : front(q));
+	edf_util += u - rt_util(p);
+	acquire(&p->lock);
+	p->rt_runtime = runtime;
+	p->rt_period = period;
+	p->rt_budget = runtime;
+	p->rt_deadline = ticks + period;
+	if (runtime > 0 || p->sclass == &edf_class)
+		runq_requeue(p, set_rt_class, runtime > 0);
+	release(&p->lock);
+	release(&ptable.lock);
+	return 0;
 }
 
-extern const int timeslices[4];
-
-int test = 0;
-void print_mlfq(char *s)
+// Copy the scheduler tunables out to c, after setting them
+// from c if set is non-zero.  The clock rate may be 10 to
+// 1000Hz and quanta 100us to 1s.  Periods counted in ticks,
+// such as sleep(), the boost period and EDF reservations,
+// scale with the clock rate.  Returns -1 if c is out of range.
+int schedconf(struct schedconf* c, int set)
 {
-	cprintf("%s:\n", s);
-	for(int i = 0; i < 4; i++){
-		if (! empty(mlfq + i)){
-			print_queue(mlfq + i);
-		}
+	int l;
+
+	if (set) {
+		if (c->hz < 10 || c->hz > 1000)
+			return -1;
+		for (l = 0; l < 4; l++)
+			if (c->quantum[l] < 100 || c->quantum[l] > 1000000)
+				return -1;
+		acquire(&tickslock);
+		if (c->hz != hz)
+			sethz(c->hz);
+		release(&tickslock);
+		acquire(&ptable.lock);
+		mlfq_setquanta(c->quantum);
+		release(&ptable.lock);
 	}
-	cprintf("actual RUNNABLEs: ");
-	for(int i = 0; i < NPROC; i++){
-		if (ptable.proc[i].state == RUNNABLE) {
-			cprintf("%d ", i);
+	c->hz = hz;
+	for (l = 0; l < 4; l++)
+		c->quantum[l] = quantum_us[l];
+	c->tsckhz = tsckhz;
+	return 0;
+}
+
+// Called from trap() when a timer interrupt finds p running,
+// n ticks after the last one: more than 1 if the CPU is
+// tickless, 0 if it woke within a tick for a sub-tick
+// quantum.  The class is charged once per elapsed tick; with
+// none, p yields only if its slice has ended by the TSC.
+// Returns 1 if p should yield.
+int sched_tick(struct proc* p, int n)
+{
+	p->ticks += n;
+	if (n == 0)
+		return rdtsc() >= p->sclass->slice_end(p);
+	for (; n > 0; n--)
+		if (p->sclass->tick(p))
+			return 1;
+	return 0;
+}
+
+// Take the next process off rq, asking each class in order
+// of precedence.  Returns 0 if rq is empty.
+static struct proc* runq_pick(struct runq* rq)
+{
+	struct proc *p = 0;
+	int i;
+
+	acquire(&rq->lock);
+	for (i = 0; rq->nqueued > 0 && i < NELEM(classes); i++) {
+		if ((p = classes[i]->pick_next(rq)) != 0) {
+			p->qlevel = -1;
+			rq->nqueued--;
+			break;
 		}
 	}
-	cprintf("\nis_runnable: ");
-	for(int i = 0; i < NPROC; i++){
-		if(is_runnable[i]){
-			cprintf("%d ", i);
+	release(&rq->lock);
+	return p;
+}
+
+// Number of processes on rq that could run now.  Parked ones
+// count once parkend has passed, so that pick_next gets to
+// release them.  Read without locks, as a hint.
+static int runq_ready(struct runq* rq)
+{
+	int n;
+
+	n = rq->nqueued;
+	if (rq->nparked > 0 && (int)(ticks - rq->parkend) < 0)
+		n -= rq->nparked;
+	return n;
+}
+
+// Return the CPU with the most processes ready to run, other
+// than self, or -1 if no other run queue has any.
+static int runq_busiest(int self)
+{
+	int c, n, best = -1, most = 0;
+
+	for (c = 0; c < ncpu; c++) {
+		if (c != self && (n = runq_ready(runqs + c)) > most) {
+			most = n;
+			best = c;
 		}
 	}
-	cprintf("\n\n");
+	return best;
 }
+
 void
 scheduler(void)
 {
   struct proc *p;
-  int first5 = 100;
-	
-	for(int i = 0; i < 4; i++){
-		init_queue(mlfq + i);
-	}
-	
-	acquire(&ptable.lock);
-	for(int i = 0; i < NPROC; i++){
-		if (ptable.proc[i].state == RUNNABLE) {
-			is_runnable[i] = 1;
-			enque(mlfq + 0, i);
-		}
-		else {
-			is_runnable[i] = 0;
-		}
-	}
-	release(&ptable.lock);
-	
-//	print_mlfq("start");
+  struct runq *rq;
+  int self, victim;
+  uint waited;
+
+  self = cpu - cpus;
+  rq = runqs + self;
   for(;;){
-	  if(first5) first5--;
     // Enable interrupts on this processor.
     sti();
-    // Loop over process table looking for process to run.
-    acquire(&ptable.lock);
-    
-#ifdef _NEW_SCHED_
-//if(first5) print_mlfq("before choose");
-	  int runnable_exists = 0;
-	  int runnable_idx;
-    
-    // update is_runnable
-    // add new runnables to queue 0
-    for (int i = 0; i < NPROC; i++){
-	    // currently runnable
-	    if (ptable.proc[i].state == RUNNABLE){
-		    if (! is_runnable[i]) {
-			    // new runnable
-			    enque(mlfq + ptable.proc[i].niceness, i);
-//			    if(first5) print_mlfq("new runnable");
-		    }
-		    // update cur is_runnable
-		    is_runnable[i] = 1;
-	    }
-	    // not runnable
-	    else {
-		    is_runnable[i] = 0;
-	    }
+
+    // Peek without locks so an idle CPU does not keep
+    // taking run queue locks away from the busy ones.  If there
+    // is nothing to run anywhere, halt until an interrupt;
+    // check again with interrupts off so that work queued
+    // by one of our own interrupt handlers is not slept on.
+    victim = -1;
+    if(runq_ready(rq) <= 0 && (victim = runq_busiest(self)) < 0){
+      cli();
+      if(runq_ready(rq) <= 0 && runq_busiest(self) < 0){
+        timerarm();
+        stihlt();
+      }
+      continue;
     }
-    
-    // choose a next p from 4 queues
-    for(int i = 0; i < 4; i++){
-	    if (! empty(mlfq + i)) {
-		    runnable_exists = 1;
-		    runnable_idx = front(mlfq + i);
-		    break;
-	    }
+
+    p = runq_pick(rq);
+    if(p == 0 && victim >= 0){
+      // Nothing local: steal the best waiter from the
+      // busiest peer.  It keeps its level and slice.
+      p = runq_pick(runqs + victim);
     }
-    
-    
-    // if no runnable process, release lock and continue loop
-    if (! runnable_exists) {
-	    release(&ptable.lock);
-	    continue;
+    if(p == 0){
+      // Another CPU took it first.
+      continue;
     }
-    
-    // run it
-  //  cprintf("switch start\n");
-    p = ptable.proc + runnable_idx;
-   // cprintf("p is runnable? %d\n", p->state == RUNNABLE);
-   
-    //deque from queue
-    deque(mlfq + p->niceness);
-    enque(mlfq + p->niceness, runnable_idx);
-   
+
+    // p is ours now, but the CPU it last ran on may still
+    // hold p->lock on its way out of switch_to().
+    acquire(&p->lock);
+    p->cpuid = self;
+    waited = ticks - p->enqtick;
+    p->waitticks += waited;
+    if(waited > p->maxwait)
+      p->maxwait = waited;
+
     switch_to(p);
-    //cprintf("switch returned\n");
-    
-//    if(first5) cprintf("sleeping: %d\n", p->state==SLEEPING);
-//    if(first5) print_mlfq("after deque");
-    
-    if (p->state == ZOMBIE || p->state == SLEEPING) {
-		// does not enque
-		rear_deque(mlfq + p->niceness);
-		is_runnable[runnable_idx] = 0;
-//    if(first5) print_mlfq("zombie or sleeping");
-    }
-//    else if (cur_niceness != p->niceness) {
-//	    // setnice() called
-//	    rear_deque(mlfq + cur_niceness);
-//	    enque(mlfq + p->niceness, runnable_idx);
-////	    cprintf("not yet implemented: setnice\n");
-//    }
-    else if (timeslices[p->niceness] <= p->timeslice) {
-	    // time's up!
-	    // enque to next queue(if any)
-	    // change niceness accordingly
-	    if (p->niceness == 3) {
-//		    enque(mlfq + 3, runnable_idx);
-	    }
-	    else {
-		    rear_deque(mlfq + p->niceness);
-		    p->niceness++;
-		    enque(mlfq + p->niceness, runnable_idx);
-	    }
-	    
-//    print_mlfq("time's up");
-    }
-    else {
-	    // yielded
-	    // add to rear of cur queue
-	    // does NOT change niceness
-//	    enque(mlfq + p->niceness, runnable_idx);
-	    
-//    print_mlfq("yielded");
+    // p is back from running.  If it is still RUNNABLE it
+    // yielded or used up its slice; let its class adjust it
+    // (MLFQ demotes on an expired slice) and put it back in
+    // line.  Processes that went to sleep or exited stay off
+    // the queues until wakeup() or kill() re-enqueues them.
+    if(p->state == RUNNABLE){
+      p->sclass->yield(p);
+      runq_enque(p);
     }
-	p->timeslice = 0;
-#else
-    
-for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->state != RUNNABLE)
-		continue;
-		
-	switch_to(p);
-}
-#endif    
-    release(&ptable.lock);
+    p->timeslice = 0;
+    release(&p->lock);
   }
 }
 
 void switch_to(struct proc* p)
 {
 	// h to chosen process.  It is the process's job
-      // to release ptable.lock and then reacquire it
+      // to release p->lock and then reacquire it
       // before jumping back to us.
 	
+	uint64 now;
+
+	now = rdtsc();
+	hist_add(p->rundelay, now - p->enqtsc);
+	hist_add(p->inqueue[p->enqlevel], now - p->lvltsc);
+	p->acctsc = now;
+	p->runstart = now;
+
 	proc = p;	// pointed by gs:4 (from proc.h)
       switchuvm(p);
       p->state = RUNNING;
+      cpu->needresched = 0;
+      cpu->lasttick = tsc2ticks(p->runstart);
+      timerarm();
+      __sync_fetch_and_add(&schedstat.nswitch, 1);
+      trace(TR_SWITCHIN, p, p->niceness);
       swtch(&cpu->scheduler, p->context);
       switchkvm();
+      acct_kernel(p);
+      p->lastrun = p->acctsc - p->runstart;
+      trace(TR_SWITCHOUT, p, p->state);
 
       // Process is done running for now.
       // It should have changed its p->state before coming back.
       proc = 0;
 }
 
-// Enter scheduler.  Must hold only ptable.lock
+// Enter scheduler.  Must hold only proc->lock
 // and have changed proc->state. Saves and restores
 // intena because intena is a property of this
 // kernel thread, not this CPU. It should
@@ -564,8 +1121,8 @@ sched(void)
 {
   int intena;
 
-  if(!holding(&ptable.lock))
-    panic("sched ptable.lock");
+  if(!holding(&proc->lock))
+    panic("sched proc->lock");
   if(cpu->ncli != 1)
     panic("sched locks");
   if(proc->state == RUNNING) {
@@ -584,10 +1141,11 @@ sched(void)
 void
 yield(void)
 {
-  acquire(&ptable.lock);  //DOC: yieldlock
+  acquire(&proc->lock);  //DOC: yieldlock
+  trace(TR_YIELD, proc, 0);
   proc->state = RUNNABLE;
   sched();
-  release(&ptable.lock);
+  release(&proc->lock);
 }
 
 // A fork child's very first scheduling by scheduler()
@@ -596,8 +1154,8 @@ void
 forkret(void)
 {
   static int first = 1;
-  // Still holding ptable.lock from scheduler.
-  release(&ptable.lock);
+  // Still holding proc->lock from scheduler.
+  release(&proc->lock);
 
   if (first) {
     // Some initialization functions must be run in the context
@@ -607,6 +1165,7 @@ forkret(void)
     iinit(ROOTDEV);
     initlog(ROOTDEV);
   }
+  acct_kernel(proc);
 
   // Return to "caller", actually trapret (see allocproc).
 }
@@ -616,57 +1175,247 @@ forkret(void)
 void
 sleep(void *chan, struct spinlock *lk)
 {
+  struct sleepq *q;
+
   if(proc == 0)
     panic("sleep");
 
   if(lk == 0)
     panic("sleep without lk");
 
-  // Must acquire ptable.lock in order to
+  // Must acquire proc->lock in order to
   // change p->state and then call sched.
-  // Once we hold ptable.lock, we can be
+  // Once we hold chan's sleep queue lock, we can be
   // guaranteed that we won't miss any wakeup
-  // (wakeup runs with ptable.lock locked),
+  // (wakeup runs with it locked),
   // so it's okay to release lk.
-  if(lk != &ptable.lock){  //DOC: sleeplock0
-    acquire(&ptable.lock);  //DOC: sleeplock1
-    release(lk);
-  }
+  q = sleepq_for(chan);
+  acquire(&q->lock);  //DOC: sleeplock1
+  acquire(&proc->lock);
+  release(lk);
+
   // Go to sleep.
   proc->chan = chan;
   proc->state = SLEEPING;
+  enque(&q->procs, proc);
+  release(&q->lock);
   sched();
 
   // Tidy up.
   proc->chan = 0;
 
   // Reacquire original lock.
-  if(lk != &ptable.lock){  //DOC: sleeplock2
-    release(&ptable.lock);
-    acquire(lk);
-  }
+  release(&proc->lock);
+  acquire(lk);
+}
+
+// Make p, sleeping on q, RUNNABLE.
+// Caller must hold q->lock and p->lock.
+static void
+wake(struct sleepq *q, struct proc *p)
+{
+  deque_proc(&q->procs, p);
+  p->state = RUNNABLE;
+  trace(TR_WAKEUP, p, 0);
+  runq_enque(p);
 }
 
 //PAGEBREAK!
 // Wake up all processes sleeping on chan.
-// The ptable lock must be held.
+void
+wakeup(void *chan)
+{
+  struct proc *p, *next;
+  struct sleepq *q;
+  int scanned, woken;
+
+  q = sleepq_for(chan);
+  scanned = woken = 0;
+  acquire(&q->lock);
+  for(p = front(&q->procs); p; p = next){
+    next = p->qnext;
+    scanned++;
+    if(p->chan == chan){
+      // Wait until p is off its CPU before queueing it.
+      acquire(&p->lock);
+      wake(q, p);
+      release(&p->lock);
+      woken++;
+    }
+  }
+  release(&q->lock);
+  __sync_fetch_and_add(&schedstat.wakeups, 1);
+  __sync_fetch_and_add(&schedstat.wakeup_scanned, scanned);
+  __sync_fetch_and_add(&schedstat.woken, woken);
+}
+
+//PAGEBREAK!
+// Timer queue: a binary min-heap of the processes sleeping in
+// sleepticks(), ordered by deadline, so the clock interrupt
+// wakes each of them once, when its deadline arrives, instead
+// of waking every sleeper on every tick.  Protected by
+// tickslock.  Deadlines are compared as signed differences so
+// that ticks may wrap.
+static struct proc *timerq[NPROC];
+static volatile int ntimerq;
+static volatile uint timerq_first;  // timerq[0]->deadline, for timerarm()
+
+// Tickless operation: rather than take every tick, each CPU
+// arms its LAPIC timer for the next tick at which it has
+// something to do.  See timerarm().
+int tickless = 1;
+
+#define BEFORE(a, b) ((int)((a)->deadline - (b)->deadline) < 0)
+
 static void
-wakeup1(void *chan)
+timerq_swap(int i, int j)
 {
-  struct proc *p;
+  struct proc *t;
 
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-    if(p->state == SLEEPING && p->chan == chan)
-      p->state = RUNNABLE;
+  t = timerq[i];
+  timerq[i] = timerq[j];
+  timerq[j] = t;
+  timerq[i]->tqidx = i;
+  timerq[j]->tqidx = j;
 }
 
-// Wake up all processes sleeping on chan.
+static void
+timerq_up(int i)
+{
+  while(i > 0 && BEFORE(timerq[i], timerq[(i-1)/2])){
+    timerq_swap(i, (i-1)/2);
+    i = (i-1)/2;
+  }
+}
+
+static void
+timerq_down(int i)
+{
+  int c;
+
+  for(;;){
+    c = 2*i + 1;
+    if(c >= ntimerq)
+      break;
+    if(c+1 < ntimerq && BEFORE(timerq[c+1], timerq[c]))
+      c++;
+    if(!BEFORE(timerq[c], timerq[i]))
+      break;
+    timerq_swap(i, c);
+    i = c;
+  }
+}
+
+static void
+timerq_insert(struct proc *p)
+{
+  p->tqidx = ntimerq++;
+  timerq[p->tqidx] = p;
+  timerq_up(p->tqidx);
+  timerq_first = timerq[0]->deadline;
+}
+
+static void
+timerq_remove(struct proc *p)
+{
+  int i;
+
+  i = p->tqidx;
+  p->tqidx = -1;
+  if(--ntimerq != i){
+    timerq[i] = timerq[ntimerq];
+    timerq[i]->tqidx = i;
+    timerq_up(i);
+    timerq_down(timerq[i]->tqidx);
+  }
+  if(ntimerq > 0)
+    timerq_first = timerq[0]->deadline;
+}
+
+// Arm this CPU's timer for the next time it has work at: the
+// end of the running process's slice (or, if idle, MAXIDLE ms
+// on or when the first parked process on its run queue is
+// due) or the nearest sleep deadline, whichever is first;
+// CPU 0 also wakes for the MLFQ boost.  With tickless off,
+// every tick.  Call with interrupts off.
+//
+// The timer queue is read without tickslock, which may be
+// held by a CPU waiting for a sleep queue.  A deadline inserted
+// meanwhile is not missed: the CPU that inserted it arms its
+// own timer again on the way into the scheduler.
 void
-wakeup(void *chan)
+timerarm(void)
 {
-  acquire(&ptable.lock);
-  wakeup1(chan);
-  release(&ptable.lock);
+  struct runq *rq;
+  uint64 due, t;
+  uint now;
+
+  now = tsc2ticks(rdtsc());
+  if(!tickless){
+    lapicarm(tick2tsc(now + 1));
+    return;
+  }
+  due = tick2tsc(now) + (uint64)MAXIDLE * tsckhz;
+  if(proc && proc->state == RUNNING && (t = proc->sclass->slice_end(proc)) < due)
+    due = t;
+  rq = runqs + (cpu - cpus);
+  if(proc == 0 && rq->nparked > 0 && (t = tick2tsc(rq->parkend)) < due)
+    due = t;
+  if(ntimerq > 0 && (t = tick2tsc(timerq_first)) < due)
+    due = t;
+  if(cpu == cpus && boost_period > 0 &&
+     (t = tick2tsc(now + boost_period - now % boost_period)) < due)
+    due = t;
+  lapicarm(due);
+}
+
+// Turn tickless operation on or off and return the previous
+// setting.  A negative on only reads it.
+int
+settickless(int on)
+{
+  int old;
+
+  old = tickless;
+  if(on >= 0)
+    tickless = on != 0;
+  return old;
+}
+
+// Sleep for n clock ticks.  Returns -1 if killed first.
+int
+sleepticks(int n)
+{
+  acquire(&tickslock);
+  tickupdate();
+  proc->deadline = ticks + n;
+  while((int)(proc->deadline - ticks) > 0){
+    if(proc->killed){
+      release(&tickslock);
+      return -1;
+    }
+    timerq_insert(proc);
+    sleep(&proc->deadline, &tickslock);
+    // Woken early, e.g. by kill(): drop the stale entry.
+    if(proc->tqidx >= 0)
+      timerq_remove(proc);
+  }
+  release(&tickslock);
+  return 0;
+}
+
+// Wake the processes whose deadline has passed.
+// Called from the clock interrupt with tickslock held.
+void
+timerq_expire(void)
+{
+  struct proc *p;
+
+  while(ntimerq > 0 && (int)(timerq[0]->deadline - ticks) <= 0){
+    p = timerq[0];
+    timerq_remove(p);
+    wakeup(&p->deadline);
+  }
 }
 
 // Kill the process with the given pid.
@@ -676,20 +1425,31 @@ int
 kill(int pid)
 {
   struct proc *p;
+  struct sleepq *q;
+  void *chan;
 
   acquire(&ptable.lock);
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->pid == pid){
-      p->killed = 1;
-      // Wake process from sleep if necessary.
-      if(p->state == SLEEPING)
-        p->state = RUNNABLE;
-      release(&ptable.lock);
-      return 0;
-    }
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -1;
   }
+  acquire(&p->lock);
+  p->killed = 1;
+  // Wake process from sleep if necessary.  Its sleep queue
+  // lock comes before p->lock, so let go and look again.
+  while(p->state == SLEEPING){
+    chan = p->chan;
+    release(&p->lock);
+    q = sleepq_for(chan);
+    acquire(&q->lock);
+    acquire(&p->lock);
+    if(p->state == SLEEPING && p->chan == chan)
+      wake(q, p);
+    release(&q->lock);
+  }
+  release(&p->lock);
   release(&ptable.lock);
-  return -1;
+  return 0;
 }
 
 //PAGEBREAK: 36
@@ -712,7 +1472,7 @@ procdump(void)
   char *state;
   uint pc[10];
 
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+  for(p = ptable.procs; p; p = p->pnext){
     if(p->state == UNUSED)
       continue;
     if(p->state >= 0 && p->state < NELEM(states) && states[p->state])
@@ -735,20 +1495,45 @@ void ps(int pid, struct ps_info *info_ptr)
 	static char* state_code2str[] = {"UNUSED", "EMBRYO", "SLEEPING", "RUNNABLE", "RUNNING", "ZOMBIE"};
 	//proc->pid, proc->niceness, state_code2str[proc->state], proc->name);
 	struct proc *p;
+	int start = info_ptr->start;
 	
   acquire(&ptable.lock);
-  
-  for(p = ptable.proc, info_ptr->arr_len = 0; p < &ptable.proc[NPROC]; p++){
-	  if(pid == 0 || p->pid == pid){
+
+  // One process by pid, or up to PSCHUNK of the whole table
+  // from slot start on; start is left at the slot to carry on
+  // from, or -1 at the end.
+  if (pid != 0) {
+	  p = findproc(pid);
+	  if (p && p->slot < start)
+		  p = 0;
+  } else {
+	  for (p = ptable.procs; p && p->slot < start; p = p->pnext)
+		  ;
+  }
+  info_ptr->start = -1;
+  for(info_ptr->arr_len = 0; p; p = pid ? 0 : p->pnext){
 	    if (p->state == UNUSED) {
 		    continue;
 	    }
+	    if (info_ptr->arr_len == PSCHUNK) {
+		    info_ptr->start = p->slot;
+		    break;
+	    }
 	    strncpy((info_ptr->arr[info_ptr->arr_len].name), p->name, 16);
-	    info_ptr->arr[info_ptr->arr_len].niceness = p->niceness;
+	    info_ptr->arr[info_ptr->arr_len].niceness = p->sclass->getnice(p);
 	    info_ptr->arr[info_ptr->arr_len].pid = p->pid;
+	    info_ptr->arr[info_ptr->arr_len].utime = tsc2us(p->utsc);
+	    info_ptr->arr[info_ptr->arr_len].stime = tsc2us(p->stsc);
+	    info_ptr->arr[info_ptr->arr_len].vsz = p->sz / 1024;
+	    info_ptr->arr[info_ptr->arr_len].rss = 0;
+	    if (p->state != EMBRYO) {
+		    // p->lock keeps exec() from freeing the page table.
+		    acquire(&p->lock);
+		    info_ptr->arr[info_ptr->arr_len].rss = uvmrss(p->pgdir, p->sz) * (PGSIZE / 1024);
+		    release(&p->lock);
+	    }
 	    strncpy((info_ptr->arr[info_ptr->arr_len].state), state_code2str[p->state], 10);
 	    (info_ptr->arr_len)++;
-    }
   }
   release(&ptable.lock);
 }
@@ -756,50 +1541,61 @@ void ps(int pid, struct ps_info *info_ptr)
 int getnice(int pid)
 {
 	struct proc *p;
+	int value;
 	
   acquire(&ptable.lock);
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-	  if (p->state == UNUSED) {
-		    continue;
-	    }
-    if(p->pid == pid){
-	    release(&ptable.lock);
-	    return p->niceness;
-    }
+  if ((p = findproc(pid)) == 0) {
+	  release(&ptable.lock);
+	  return -1;
   }
+  value = p->sclass->getnice(p);
   release(&ptable.lock);
-  return -1;
+  return value;
 }
 
 int setnice(int pid, int value)
 {
-	if (! (0 <= value && value <= 3))
-	{
-		return -1;
-	}
-	
 	struct proc *p;
+	int r;
 	
   acquire(&ptable.lock);
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-	  if (p->state == UNUSED) {
-		    continue;
-	    }
-    if(p->pid == pid){
-	    deque_by_idx(mlfq + p->niceness, p - ptable.proc);
-	    enque(mlfq + value, p - ptable.proc);
-	    p->niceness = value;
-	    proc->state = RUNNABLE;
-	    sched();
-	    release(&ptable.lock);
-	    return 0;
-    }
+  if ((p = findproc(pid)) == 0) {
+	  release(&ptable.lock);
+	  return -1;
   }
+  acquire(&p->lock);
   release(&ptable.lock);
-  return -1;
+  r = runq_requeue(p, set_niceness, value);
+  // A queued p was re-queued and runq_kick() checked it
+  // against whoever runs there; if we lowered ourselves,
+  // check what is waiting here.
+  if (r == 0 && p == proc && runq_outranked(proc))
+	  cpu->needresched = 1;
+  release(&p->lock);
+  return r < 0 ? -1 : 0;
 }
 
 // PA #2
+// Fill in ptr from the first NPSTAT slots; caller must hold
+// ptable.lock.  Slots not carved yet read as unused.
+static void fill_pstat(struct pstat* ptr)
+{
+	struct proc *p = ptable.procs;
+
+	memset(ptr, 0, sizeof(*ptr));
+	for(int i = 0; i < NPSTAT && p; i++, p = p->pnext)
+	{
+		ptr->inuse[i] = p->state != UNUSED;
+		ptr->nice[i] = ptr->inuse[i] ? p->sclass->getnice(p) : 0;
+		ptr->pid[i] = p->pid;
+		ptr->ticks[i] = p->ticks;
+		ptr->wait[i] = p->waitticks;
+		ptr->maxwait[i] = p->maxwait;
+		ptr->utime[i] = tsc2us(p->utsc);
+		ptr->stime[i] = tsc2us(p->stsc);
+	}
+}
+
 int getpinfo(struct pstat* ptr)
 {
 	if (ptr == 0)
@@ -808,15 +1604,102 @@ int getpinfo(struct pstat* ptr)
 	}
 	
 	acquire(&ptable.lock);
+	fill_pstat(ptr);
+	release(&ptable.lock);
   
-	for(int i = 0; i < NPROC; i++)
-	{
-		ptr->inuse[i] = ptable.proc[i].state != UNUSED;
-		ptr->nice[i] = ptable.proc[i].niceness;
-		ptr->pid[i] = ptable.proc[i].pid;
-		ptr->ticks[i] = ptable.proc[i].ticks;
+	return 0;
+}
+
+// Copy out a pinfo record for each process in use at slot
+// start or later, at most n of them, and return how many.
+// Each record carries its slot, so the caller can carry on
+// from the last one plus one.
+int procinfo(int start, struct pinfo* buf, int n)
+{
+	struct proc *p;
+	struct pinfo *r;
+	int i = 0;
+
+	acquire(&ptable.lock);
+	for (p = ptable.procs; p && i < n; p = p->pnext) {
+		if (p->slot < start || p->state == UNUSED)
+			continue;
+		r = buf + i++;
+		r->slot = p->slot;
+		r->pid = p->pid;
+		r->nice = p->sclass->getnice(p);
+		r->cpu = p->cpuid;
+		r->ticks = p->ticks;
+		r->wait = p->waitticks;
+		r->maxwait = p->maxwait;
+		r->utime = tsc2us(p->utsc);
+		r->stime = tsc2us(p->stsc);
+		memmove(r->rundelay, p->rundelay, sizeof(r->rundelay));
+		memmove(r->inqueue, p->inqueue, sizeof(r->inqueue));
 	}
 	release(&ptable.lock);
-  
+	return i;
+}
+
+// Add lk's contention counters to ls.
+static void lockstat_add(struct lockstat* ls, struct spinlock* lk)
+{
+	ls->nlock++;
+	ls->acquires += lk->nacquire;
+	ls->contended += lk->ncontend;
+	ls->spins += lk->nspin;
+}
+
+// Copy out contention counters for the scheduler's locks, at
+// most n entries, and return how many.  The counters are read
+// without the locks and may be slightly stale.
+int getlockstat(struct lockstat* ls, int n)
+{
+	struct proc *p;
+	int i, k = 0;
+
+	if (n > NLOCKSTAT)
+		n = NLOCKSTAT;
+	memset(ls, 0, n * sizeof(*ls));
+	if (k < n) {
+		safestrcpy(ls[k].name, "ptable", sizeof(ls[k].name));
+		lockstat_add(ls + k++, &ptable.lock);
+	}
+	if (k < n) {
+		safestrcpy(ls[k].name, "proc", sizeof(ls[k].name));
+		for (p = ptable.procs; p; p = p->pnext)
+			lockstat_add(ls + k, &p->lock);
+		k++;
+	}
+	if (k < n) {
+		safestrcpy(ls[k].name, "sleepq", sizeof(ls[k].name));
+		for (i = 0; i < NSLEEPQ; i++)
+			lockstat_add(ls + k, &sleepq[i].lock);
+		k++;
+	}
+	if (k < n) {
+		safestrcpy(ls[k].name, "runq", sizeof(ls[k].name));
+		for (i = 0; i < ncpu; i++)
+			lockstat_add(ls + k, &runqs[i].lock);
+		k++;
+	}
+	if (k < n) {
+		safestrcpy(ls[k].name, "time", sizeof(ls[k].name));
+		lockstat_add(ls + k++, &tickslock);
+	}
+	return k;
+}
+
+// Copy the global scheduler counters out to st.
+int getschedstat(struct schedstat* st)
+{
+	*st = schedstat;
+	st->ncpu = ncpu;
+	st->tickless = tickless;
+	for (int c = 0; c < ncpu; c++) {
+		st->cpu_ticks[c] = cpus[c].nticks;
+		st->cpu_idle[c] = cpus[c].idleticks;
+		st->cpu_intr[c] = cpus[c].nintr;
+	}
 	return 0;
-}
\ No newline at end of file
+}
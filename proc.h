@@ -8,6 +8,11 @@ struct cpu {
   volatile uint started;       // Has the CPU started?
   int ncli;                    // Depth of pushcli nesting.
   int intena;                  // Were interrupts enabled before pushcli?
+  uint nticks;                 // Clock ticks seen by timer interrupts
+  uint idleticks;              // ... of which the CPU was idle
+  volatile int needresched;    // A queued process outranks proc
+  uint lasttick;               // Last tick counted by trap()
+  uint nintr;                  // Timer interrupts taken
 
   // Cpu-local storage variables; see below
   struct cpu *cpu;
@@ -49,20 +54,37 @@ struct context {
 
 enum procstate { UNUSED, EMBRYO, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
+// A program segment exec() left for the page fault handler:
+// [va, va+memsz) comes from the executable at off, zero past
+// filesz.
+struct seg {
+  uint va;
+  uint memsz;
+  uint filesz;
+  uint off;
+  int writable;
+};
+
 // Per-process state
 struct proc {
   uint sz;                     // Size of process memory (bytes)
   pde_t* pgdir;                // Page table
   char *kstack;                // Bottom of kernel stack for this process
+  struct spinlock lock;        // Protects state, chan, killed, pgdir; see proc.c
   enum procstate state;        // Process state
   int pid;                     // Process ID
   struct proc *parent;         // Parent process
+  struct proc *children;       // First child, linked by sibling
+  struct proc *sibling;        // Next child of parent
   struct trapframe *tf;        // Trap frame for current syscall
   struct context *context;     // swtch() here to run process
   void *chan;                  // If non-zero, sleeping on chan
   int killed;                  // If non-zero, have been killed
   struct file *ofile[NOFILE];  // Open files
   struct inode *cwd;           // Current directory
+  struct inode *exe;           // Executable, for paging in seg
+  struct seg seg[NSEG];        // Program segments
+  int nseg;
   char name[16];               // Process name (debugging)
   
   //PA #1
@@ -71,10 +93,37 @@ struct proc {
   // PA #2
   int ticks;
   int timeslice;	// cur_tick
-};
 
-// PA #2
-#define _NEW_SCHED_
+  struct proc *qnext;          // Next process in run or sleep queue
+  struct proc *qprev;          // Previous process in run or sleep queue
+  int qlevel;                  // Run queue level, or -1 if not queued
+  int cpuid;                   // CPU whose run queue p is on / last ran on
+  struct sched_class *sclass;  // Scheduling class, see sched.h
+  int snice;                   // Stride nice value, 0..39
+  uint pass;                   // Stride pass
+  uint enqtick;                // ticks when p was last enqueued
+  uint waitticks;              // Total ticks spent RUNNABLE on a queue
+  uint maxwait;                // Longest single wait on a queue
+  uint64 enqtsc;               // rdtsc() when enqueued, for run delay
+  uint64 lvltsc;               // rdtsc() when queued at enqlevel
+  int enqlevel;                // Run queue level when queued
+  uint rundelay[NHIST];        // Run delay histogram, see pinfo
+  uint inqueue[4][NHIST];      // Time queued per level, likewise
+  uint64 utsc;                 // TSC cycles run in user mode
+  uint64 stsc;                 // ... and in the kernel
+  uint64 acctsc;               // rdtsc() when last charged
+  uint64 runstart;             // rdtsc() when last switched in
+  uint64 lastrun;              // Cycles it ran for, last time
+  uint deadline;               // sleepticks() wakeup tick
+  int tqidx;                   // Index in timer queue, or -1
+  struct proc *hnext;          // Next in pid hash chain, or free slot
+  struct proc *pnext;          // Next slot in the process table
+  int slot;                    // Index in the process table
+  int rt_runtime;              // EDF reservation: ticks per period, or 0
+  int rt_period;               // EDF period in ticks
+  int rt_budget;               // Ticks left in the current period
+  uint rt_deadline;            // End of the current period
+};
 
 
 
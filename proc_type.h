@@ -6,20 +6,172 @@ struct ps_info_record {
 	int niceness;
 	char state[11];
 	char name[16];
+	uint utime;	// microseconds in user mode
+	uint stime;	// microseconds in the kernel
+	uint vsz;	// kilobytes of address space
+	uint rss;	// kilobytes of it backed by memory
 };
+
+// ps_inside() returns the table PSCHUNK processes at a time:
+// set start to 0, and call again while it is not -1.
+#define PSCHUNK	32
+
 struct ps_info {
+	int start;	// slot to start from; -1 when done
 	int arr_len;
-	struct ps_info_record arr[NPROC];
+	struct ps_info_record arr[PSCHUNK];
 };
 
 #ifndef _PSTAT_H_
 #define _PSTAT_H_
 
+// getpinfo() covers the first NPSTAT slots of the process
+// table; procinfo() covers all of it.
+#define NPSTAT	64
+
 struct pstat {
-	int inuse[NPROC];	// isn't UNUSED
-	int nice[NPROC];	// nice
-	int pid[NPROC];	// pid
-	int ticks[NPROC];	// num of ticks accumulated
+	int inuse[NPSTAT];	// isn't UNUSED
+	int nice[NPSTAT];	// nice
+	int pid[NPSTAT];	// pid
+	int ticks[NPSTAT];	// num of ticks accumulated
+	int wait[NPSTAT];	// ticks spent runnable but waiting
+	int maxwait[NPSTAT];	// longest single wait, in ticks
+	uint utime[NPSTAT];	// microseconds in user mode
+	uint stime[NPSTAT];	// microseconds in the kernel
+};
+
+// One process, from procinfo(), with log2 histograms of run
+// delay (enqueued to switched in) and of time spent queued at
+// each run queue level.  Bucket 0 counts delays under 1024
+// TSC cycles, bucket i > 0 those under 1024 << i; the last
+// bucket also takes everything longer.
+struct pinfo {
+	int slot;	// process table slot
+	int pid;
+	int nice;
+	int cpu;	// CPU it last ran on, or -1
+	int ticks;
+	int wait;
+	int maxwait;
+	uint utime;
+	uint stime;
+	uint rundelay[NHIST];
+	uint inqueue[4][NHIST];
+};
+
+#endif
+
+#ifndef _SCHEDPOLICY_H_
+#define _SCHEDPOLICY_H_
+
+// Scheduling policies, see setsched().
+#define SCHED_MLFQ	0
+#define SCHED_RR	1
+#define SCHED_STRIDE	2
+#define SCHED_EDF	3	// per process only, see reserve()
+
+#endif
+
+#ifndef _SCHEDSTAT_H_
+#define _SCHEDSTAT_H_
+
+// System-wide scheduler counters, see getschedstat().
+struct schedstat {
+	uint wakeups;		// wakeup() calls
+	uint woken;		// processes made RUNNABLE by them
+	uint wakeup_scanned;	// sleepers examined by them
+	uint nswitch;		// context switches into a process
+	uint ipis;		// reschedule IPIs sent
+	int ncpu;		// CPUs online
+	uint cpu_ticks[NCPU];	// clock ticks per CPU
+	uint cpu_idle[NCPU];	// ... that found the CPU idle
+	uint cpu_intr[NCPU];	// timer interrupts per CPU
+	int tickless;		// see settickless()
+};
+
+#endif
+
+#ifndef _LOCKSTAT_H_
+#define _LOCKSTAT_H_
+
+// Contention counters for one kernel lock, or summed over a
+// family of them (every proc lock, every run queue ...), see
+// getlockstat().
+#define NLOCKSTAT	8
+
+struct lockstat {
+	char name[16];
+	uint nlock;		// locks summed
+	uint acquires;
+	uint contended;		// acquires that had to wait
+	uint spins;		// failed attempts while waiting
+};
+
+#endif
+
+#ifndef _SCHEDCONF_H_
+#define _SCHEDCONF_H_
+
+// Scheduler tunables, see schedconf().
+struct schedconf {
+	int hz;			// clock ticks per second
+	uint quantum[4];	// MLFQ quantum per level, microseconds
+	uint tsckhz;		// TSC cycles per millisecond, read only
+};
+
+#endif
+
+#ifndef _WAITPID_H_
+#define _WAITPID_H_
+
+// waitpid() options
+#define WNOHANG 1	// return 0 instead of sleeping
+
+#endif
+
+#ifndef _VMSTAT_H_
+#define _VMSTAT_H_
+
+// Physical memory and paging counters, see getvmstat().
+#define NORDER	11	// free block sizes, 4K << 0 to 4K << 10
+
+struct vmstat {
+	uint freepages;		// free pages, in blocks or CPU caches
+	uint cowshared;		// pages fork() shared instead of copying
+	uint cowfaults;		// writes to a copy-on-write page
+	uint cowcopies;		// ... that had to copy it
+	uint lazypages;		// zeroed heap pages mapped on first touch
+	uint pageins;		// program pages mapped on first touch
+	uint ipagereads;	// ... that were read from the file
+	uint ipagecached;	// executable pages in the page cache
+	uint kallochits;	// kalloc()s served from the CPU's cache
+	uint kallocrefills;	// times a CPU's cache was refilled
+	uint kfreedrains;	// ... or drained by kfree()
+	uint kmemacquires;	// acquires of the global free list lock
+	uint kmemcontended;	// ... that had to wait
+	uint freeblocks[NORDER];	// free blocks of 4K << order
+};
+
+#endif
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+// Scheduler trace events, see trace.c and settrace().
+#define TR_SWITCHIN	1	// arg: MLFQ level it runs at
+#define TR_SWITCHOUT	2	// arg: state it left the CPU in
+#define TR_ENQUEUE	3	// arg: run queue level
+#define TR_DEMOTE	4	// arg: new MLFQ level
+#define TR_WAKEUP	5	// arg: 0
+#define TR_YIELD	6	// arg: 0
+
+struct tevent {
+	uint64 tsc;		// rdtsc() on the recording CPU
+	uint tick;		// ticks
+	int pid;
+	uchar type;		// TR_*
+	uchar cpu;
+	short arg;
 };
 
 #endif
@@ -27,19 +179,21 @@ struct pstat {
 #ifndef _QUEUE_H_
 #define _QUEUE_H_
 
+struct proc;
+
+// Intrusive FIFO of processes, linked through
+// proc->qnext and proc->qprev.
 typedef struct queue {
-	int front;
-	int rear;
-	int pids[NPROC + 1]; // ptable slot id's
+	struct proc *head;
+	struct proc *tail;
 } queue;
 
 void init_queue(queue*);
-void enque(queue*, int);
-int deque(queue*);
-int rear_deque(queue*);
-int deque_by_idx(queue*, int);
+void enque(queue*, struct proc*);
+void enque_before(queue*, struct proc*, struct proc*);
+struct proc* deque(queue*);
+void deque_proc(queue*, struct proc*);
 int empty(queue*);
-int front(queue*);
-void print_queue(queue*);
+struct proc* front(queue*);
 
-#endif
\ No newline at end of file
+#endif
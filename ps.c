@@ -10,47 +10,50 @@
 void ps(int fd)
 {
 	struct ps_info info;
-	ps_inside(fd, &info);
 	
-	printf(2, "pid      nice state      name\n");
-	printf(2, "-----------------------------\n");
-	for (int i = 0; i < info.arr_len; i++){
-		char *name = info.arr[i].name;
-		int niceness = info.arr[i].niceness;
-		char *state = info.arr[i].state;
-		int pid = info.arr[i].pid;
-		
-		char buf[BUF_SIZE];
-		int digits;
-		int i;
-		
-		memset(buf, ' ', BUF_SIZE);
-		for (digits = (int)1e7, i = 0; digits >= 1; digits /= 10) {
-			int div = pid / digits;
-			int mod = pid % digits;
-			if (div != 0) {
-				buf[i++] = div + '0';
+	printf(2, "pid      nice state      name     user(us)\tsys(us)\tvsz(K)\trss(K)\n");
+	printf(2, "--------------------------------------------------------------------------\n");
+	for (info.start = 0; info.start >= 0; ) {
+		ps_inside(fd, &info);
+		for (int i = 0; i < info.arr_len; i++){
+			char *name = info.arr[i].name;
+			int niceness = info.arr[i].niceness;
+			char *state = info.arr[i].state;
+			int pid = info.arr[i].pid;
+			
+			char buf[BUF_SIZE];
+			int digits;
+			int k;
+			
+			memset(buf, ' ', BUF_SIZE);
+			for (digits = (int)1e7, k = 0; digits >= 1; digits /= 10) {
+				int div = pid / digits;
+				int mod = pid % digits;
+				if (div != 0) {
+					buf[k++] = div + '0';
+				}
+				pid = mod;
 			}
-			pid = mod;
-		}
-		if (niceness / 10 == 0) {
-			buf[9] = niceness + '0';
-		}
-		else {
-			buf[9] = niceness / 10 + '0';
-			buf[10] = niceness % 10 + '0';
+			if (niceness / 10 == 0) {
+				buf[9] = niceness + '0';
+			}
+			else {
+				buf[9] = niceness / 10 + '0';
+				buf[10] = niceness % 10 + '0';
+			}
+			memmove(buf + 14, state, strlen(state));
+			memmove(buf + 25, name, strlen(name));
+			buf[BUF_SIZE - 1] = '\0';
+			
+			printf(2, "%s %d\t%d\t%d\t%d\n", buf, info.arr[i].utime, info.arr[i].stime,
+			       info.arr[i].vsz, info.arr[i].rss);
 		}
-		memmove(buf + 14, state, strlen(state));
-		memmove(buf + 25, name, strlen(name));
-		buf[BUF_SIZE - 1] = '\0';
-		
-		printf(2, "%s\n", buf);
 	}
 	
 }
 
 int main(int argc, char** argv) {
-	char *pid_str = argv[1];
+	char *pid_str = argc > 1 ? argv[1] : "0";
 	int pid;
 	
 	for (pid = 0; *pid_str != '\0'; pid_str++) {
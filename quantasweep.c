@@ -0,0 +1,169 @@
+// Scheduler quantum / clock rate sweep.
+// For each configuration in the table below, sets the clock
+// rate and MLFQ quanta with schedconf(), runs N loop-style CPU
+// hogs next to M short interactive jobs for a fixed wall-clock
+// time, and reports hog throughput and interactive response
+// time.  The original settings are restored at the end.
+//
+// usage: quantasweep [nhogs [ninteractive [ms]]]
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "proc_type.h"
+#include "x86.h"
+
+#define CHUNK 100000
+
+struct config {
+  int hz;
+  uint quantum[4];
+} configs[] = {
+  { 100,  { 10000, 20000, 40000, 80000 } },
+  { 100,  { 2500, 5000, 10000, 20000 } },
+  { 100,  { 40000, 80000, 160000, 320000 } },
+  { 250,  { 4000, 8000, 16000, 32000 } },
+  { 1000, { 1000, 2000, 4000, 8000 } },
+  { 1000, { 10000, 20000, 40000, 80000 } },
+};
+
+struct result {
+  int kind;     // 0 = hog, 1 = interactive
+  int work;     // hog: chunks of CHUNK iterations; interactive: jobs
+  uint worst;   // interactive: worst response in us
+  uint total;   // interactive: summed response in us
+};
+
+uint cycperus;
+
+void
+hog(int fd, uint64 end)
+{
+  struct result r;
+  volatile int i;
+
+  memset(&r, 0, sizeof(r));
+  while(rdtsc() < end){
+    for(i = 0; i < CHUNK; i++)
+      ;
+    r.work++;
+  }
+  write(fd, &r, sizeof(r));
+  exit();
+}
+
+// Each job sleeps for a tick, then does a short burst of
+// work; the response is how much longer than one tick the
+// sleep and burst took together.
+void
+interactive(int fd, uint64 end, int hz)
+{
+  struct result r;
+  volatile int i;
+  uint64 t0;
+  uint us, tick;
+
+  memset(&r, 0, sizeof(r));
+  r.kind = 1;
+  tick = 1000000 / hz;
+  while(rdtsc() < end){
+    t0 = rdtsc();
+    sleep(1);
+    for(i = 0; i < CHUNK / 10; i++)
+      ;
+    us = (uint)(rdtsc() - t0) / cycperus;
+    us = us > tick ? us - tick : 0;
+    r.total += us;
+    if(us > r.worst)
+      r.worst = us;
+    r.work++;
+  }
+  write(fd, &r, sizeof(r));
+  exit();
+}
+
+void
+run(struct config *c, int nhogs, int nint, int ms)
+{
+  struct schedconf sc;
+  struct result r;
+  uint64 end;
+  int i, n, pid, fds[2];
+  int hogwork, jobs;
+  uint worst, total;
+
+  schedconf(&sc, 0);
+  sc.hz = c->hz;
+  memmove(sc.quantum, c->quantum, sizeof(sc.quantum));
+  if(schedconf(&sc, 1) < 0){
+    printf(1, "quantasweep: bad config hz %d\n", c->hz);
+    return;
+  }
+  if(pipe(fds) < 0){
+    printf(1, "quantasweep: pipe failed\n");
+    exit();
+  }
+  end = rdtsc() + (uint64)ms * sc.tsckhz;
+  n = 0;
+  for(i = 0; i < nhogs + nint; i++){
+    pid = fork();
+    if(pid < 0)
+      break;
+    if(pid == 0){
+      close(fds[0]);
+      if(i < nhogs)
+        hog(fds[1], end);
+      interactive(fds[1], end, c->hz);
+    }
+    n++;
+  }
+  close(fds[1]);
+
+  hogwork = jobs = 0;
+  worst = total = 0;
+  while(read(fds[0], &r, sizeof(r)) == sizeof(r)){
+    if(r.kind == 0){
+      hogwork += r.work;
+    } else {
+      jobs += r.work;
+      total += r.total;
+      if(r.worst > worst)
+        worst = r.worst;
+    }
+  }
+  close(fds[0]);
+  for(i = 0; i < n; i++)
+    wait();
+
+  printf(1, "%d\t%d/%d/%d/%d\t%d\t%d\t%d\t%d\n", c->hz,
+         c->quantum[0], c->quantum[1], c->quantum[2], c->quantum[3],
+         hogwork * 1000 / ms, jobs, jobs > 0 ? total / jobs : 0, worst);
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct schedconf old;
+  int nhogs, nint, ms, i;
+
+  nhogs = argc > 1 ? atoi(argv[1]) : 4;
+  nint = argc > 2 ? atoi(argv[2]) : 2;
+  ms = argc > 3 ? atoi(argv[3]) : 3000;
+  if(ms <= 0)
+    ms = 1;
+
+  if(schedconf(&old, 0) < 0){
+    printf(2, "quantasweep: schedconf failed\n");
+    exit();
+  }
+  cycperus = old.tsckhz / 1000;
+  if(cycperus == 0)
+    cycperus = 1;
+  printf(1, "quantasweep: %d hogs, %d interactive, %d ms per config\n",
+         nhogs, nint, ms);
+  printf(1, "hz\tquanta(us)\t\tchunks/s\tjobs\tavg(us)\tworst(us)\n");
+  for(i = 0; i < sizeof(configs) / sizeof(configs[0]); i++)
+    run(&configs[i], nhogs, nint, ms);
+  schedconf(&old, 1);
+  exit();
+}
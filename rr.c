@@ -0,0 +1,97 @@
+// Round-robin scheduling class.
+// One FIFO per CPU and a one-tick quantum; niceness is
+// recorded but ignored.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "proc_type.h"
+#include "sched.h"
+
+#define RRSLICE 1   // ticks per quantum
+
+static void
+rr_enqueue(struct runq *rq, struct proc *p)
+{
+  enque(&rq->rr, p);
+  p->qlevel = 0;
+}
+
+static void
+rr_dequeue(struct runq *rq, struct proc *p)
+{
+  deque_proc(&rq->rr, p);
+}
+
+static struct proc*
+rr_pick_next(struct runq *rq)
+{
+  return deque(&rq->rr);
+}
+
+static struct proc*
+rr_peek(struct runq *rq)
+{
+  return front(&rq->rr);
+}
+
+static int
+rr_tick(struct proc *p)
+{
+  p->timeslice++;
+  return p->timeslice >= RRSLICE;
+}
+
+static uint64
+rr_slice_end(struct proc *p)
+{
+  int n = RRSLICE - p->timeslice;
+  return tick2tsc(tsc2ticks(rdtsc()) + (n > 0 ? n : 1));
+}
+
+static void
+rr_yield(struct proc *p)
+{
+}
+
+static int
+rr_preempt(struct proc *running, struct proc *p)
+{
+  return 0;
+}
+
+// Nice values are kept as MLFQ levels, 0..3, so that
+// switching back to MLFQ finds them in range.
+static int
+rr_setnice(struct proc *p, int value)
+{
+  if(value < 0 || value > 3)
+    return -1;
+  p->niceness = value;
+  return 0;
+}
+
+static int
+rr_getnice(struct proc *p)
+{
+  return p->niceness;
+}
+
+struct sched_class rr_class = {
+  .name = "rr",
+  .policy = SCHED_RR,
+  .enqueue = rr_enqueue,
+  .dequeue = rr_dequeue,
+  .pick_next = rr_pick_next,
+  .peek = rr_peek,
+  .tick = rr_tick,
+  .slice_end = rr_slice_end,
+  .yield = rr_yield,
+  .preempt = rr_preempt,
+  .setnice = rr_setnice,
+  .getnice = rr_getnice,
+};
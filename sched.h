@@ -0,0 +1,78 @@
+// Scheduling classes.
+//
+// Every RUNNABLE process that is not running sits on the run
+// queue of exactly one CPU, filed there by its class,
+// p->sclass.  The generic code in proc.c picks the CPU, keeps
+// nqueued and the wait accounting, and asks the classes in
+// order of precedence for the next process to run.  Hooks
+// taking a process, except tick and slice_end, are called
+// with its p->lock held; hooks taking a runq are called with
+// rq->lock held, and pick_next and peek with that alone.
+
+// Per-CPU run queue.  A class only touches its own fields,
+// and nparked and parkend if it holds processes back.  The
+// counts may be read without locks as a hint.
+struct runq {
+  struct spinlock lock;
+  volatile int nqueued;        // Processes queued, all classes
+  volatile int nparked;        // Of those, held back until a later tick
+  volatile uint parkend;       // Tick the first parked one is due
+
+  // mlfq.c
+  queue mlfq[4];               // One FIFO per level
+  volatile uint bitmap;        // Bit i set iff mlfq[i] is non-empty
+
+  // rr.c
+  queue rr;
+
+  // stride.c
+  queue stride;                // Sorted by pass
+  uint stride_pass;            // Pass of the last process picked
+
+  // edf.c
+  queue edf;                   // Sorted by deadline
+  queue edf_throttled;         // Out of budget until their period ends
+};
+
+struct sched_class {
+  char *name;
+  int policy;                  // SCHED_* id, see setsched()
+
+  // File p on rq; must set p->qlevel >= 0.
+  void (*enqueue)(struct runq*, struct proc*);
+  // Take queued p off rq.
+  void (*dequeue)(struct runq*, struct proc*);
+  // Take the next process to run off rq, or return 0.
+  struct proc* (*pick_next)(struct runq*);
+  // The process pick_next would take, left on rq, or 0.
+  struct proc* (*peek)(struct runq*);
+  // The running p took a timer tick; return 1 to preempt it.
+  // Called from trap() without locks.
+  int (*tick)(struct proc*);
+  // The TSC value at which tick() would next preempt the
+  // running p; a tickless CPU sleeps until then.  Called
+  // without locks.
+  uint64 (*slice_end)(struct proc*);
+  // The running p gave up the CPU but is still RUNNABLE;
+  // called just before it is enqueued again.
+  void (*yield)(struct proc*);
+  // Should newly queued p preempt running, of the same class?
+  int (*preempt)(struct proc *running, struct proc *p);
+  // Set p's nice value, which each class interprets (and
+  // range-checks) in its own way; return -1 if out of range.
+  // p is off the run queue while this is called.
+  int (*setnice)(struct proc*, int);
+  int (*getnice)(struct proc*);
+};
+
+#define STRIDE_NICE_DEFAULT 20
+
+extern struct runq runqs[NCPU];
+extern struct sched_class edf_class;
+extern struct sched_class mlfq_class;
+extern struct sched_class rr_class;
+extern struct sched_class stride_class;
+
+// mlfq.c
+extern uint quantum_us[4];
+void mlfq_setquanta(uint*);
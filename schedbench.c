@@ -0,0 +1,80 @@
+// Scheduler pick-latency microbenchmark.
+// Fills the process table with N-3 processes parked on a pipe
+// (init, sh and schedbench itself take the other three slots),
+// then times a tight yield() loop.  Every yield is one trip
+// through sched() -> scheduler() -> pick -> swtch back, so the
+// cycles per yield track the cost of picking the next process
+// while the rest of the table sits idle.
+//
+// usage: schedbench [nprocs ...]   (default: 8 64 256 1024)
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "x86.h"
+
+#define ITERS 2000
+
+void
+bench(int n)
+{
+  int fds[2], i, nparked, pid;
+  uint t0, t1, up0, up1;
+  char c;
+
+  nparked = n - 3;
+  if(nparked < 0)
+    nparked = 0;
+  if(pipe(fds) < 0){
+    printf(1, "schedbench: pipe failed\n");
+    exit();
+  }
+  for(i = 0; i < nparked; i++){
+    pid = fork();
+    if(pid < 0)
+      break;
+    if(pid == 0){
+      close(fds[1]);
+      read(fds[0], &c, 1);
+      exit();
+    }
+  }
+  nparked = i;
+  close(fds[0]);
+
+  // Let the children reach read() and go to sleep.
+  sleep(10);
+
+  up0 = uptime();
+  t0 = (uint)rdtsc();
+  for(i = 0; i < ITERS; i++)
+    yield();
+  t1 = (uint)rdtsc();
+  up1 = uptime();
+
+  close(fds[1]);
+  for(i = 0; i < nparked; i++)
+    wait();
+
+  printf(1, "procs %d parked %d: %d cycles/yield (%d ticks for %d yields)\n",
+         nparked + 3, nparked, (t1 - t0) / ITERS, up1 - up0, ITERS);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i;
+
+  printf(1, "schedbench: NPROC %d\n", NPROC);
+  if(argc < 2){
+    bench(8);
+    bench(64);
+    bench(256);
+    bench(1024);
+  } else {
+    for(i = 1; i < argc; i++)
+      bench(atoi(argv[i]));
+  }
+  exit();
+}
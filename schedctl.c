@@ -0,0 +1,45 @@
+// Read or set the scheduler tunables (see schedconf()).
+//
+// usage: schedctl                     print the settings
+//        schedctl hz N                set the clock rate
+//        schedctl quanta q0 q1 q2 q3  set the MLFQ quanta, in us
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "proc_type.h"
+
+void
+usage(void)
+{
+  printf(2, "usage: schedctl [hz N | quanta q0 q1 q2 q3]\n");
+  exit();
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct schedconf c;
+  int l;
+
+  if(schedconf(&c, 0) < 0){
+    printf(2, "schedctl: schedconf failed\n");
+    exit();
+  }
+  if(argc == 3 && strcmp(argv[1], "hz") == 0){
+    c.hz = atoi(argv[2]);
+  } else if(argc == 6 && strcmp(argv[1], "quanta") == 0){
+    for(l = 0; l < 4; l++)
+      c.quantum[l] = atoi(argv[l+2]);
+  } else if(argc != 1){
+    usage();
+  }
+  if(argc > 1 && schedconf(&c, 1) < 0){
+    printf(2, "schedctl: out of range (hz 10-1000, quanta 100-1000000us)\n");
+    exit();
+  }
+  printf(1, "hz %d (tick %dus), tsc %d kHz\n", c.hz, 1000000 / c.hz, c.tsckhz);
+  printf(1, "quanta %d %d %d %d us\n",
+         c.quantum[0], c.quantum[1], c.quantum[2], c.quantum[3]);
+  exit();
+}
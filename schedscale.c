@@ -0,0 +1,122 @@
+// Scheduler scaling benchmark.
+// Runs N loop-style CPU hogs next to M short interactive jobs
+// for a fixed number of ticks and reports hog throughput and
+// interactive response time.  Boot with different CPU counts
+// (make qemu CPUS=1, 2, 4, 8) and compare the per-CPU numbers.
+//
+// usage: schedscale [nhogs [ninteractive [ticks]]]
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "proc_type.h"
+
+#define CHUNK 100000
+
+struct result {
+  int kind;     // 0 = hog, 1 = interactive
+  int work;     // hog: chunks of CHUNK iterations; interactive: jobs
+  int worst;    // interactive: worst response in ticks
+  int total;    // interactive: summed response in ticks
+};
+
+void
+hog(int fd, int end)
+{
+  struct result r;
+  volatile int i;
+
+  memset(&r, 0, sizeof(r));
+  while(uptime() < end){
+    for(i = 0; i < CHUNK; i++)
+      ;
+    r.work++;
+  }
+  write(fd, &r, sizeof(r));
+  exit();
+}
+
+// Each job sleeps for a tick, then does a short burst of
+// work; the response is how long the burst took to finish
+// after the sleep was due to end.
+void
+interactive(int fd, int end)
+{
+  struct result r;
+  volatile int i;
+  int t0, dt;
+
+  memset(&r, 0, sizeof(r));
+  r.kind = 1;
+  while(uptime() < end){
+    t0 = uptime();
+    sleep(1);
+    for(i = 0; i < CHUNK / 10; i++)
+      ;
+    dt = uptime() - t0 - 1;
+    if(dt < 0)
+      dt = 0;
+    r.total += dt;
+    if(dt > r.worst)
+      r.worst = dt;
+    r.work++;
+  }
+  write(fd, &r, sizeof(r));
+  exit();
+}
+
+int
+main(int argc, char *argv[])
+{
+  int nhogs, nint, len, end, i, n, fds[2];
+  int hogwork, jobs, worst, total;
+  struct result r;
+  struct schedstat st;
+
+  nhogs = argc > 1 ? atoi(argv[1]) : 4;
+  nint = argc > 2 ? atoi(argv[2]) : 2;
+  len = argc > 3 ? atoi(argv[3]) : 500;
+
+  if(pipe(fds) < 0){
+    printf(1, "schedscale: pipe failed\n");
+    exit();
+  }
+  end = uptime() + len;
+  n = 0;
+  for(i = 0; i < nhogs + nint; i++){
+    int pid = fork();
+    if(pid < 0)
+      break;
+    if(pid == 0){
+      close(fds[0]);
+      if(i < nhogs)
+        hog(fds[1], end);
+      interactive(fds[1], end);
+    }
+    n++;
+  }
+  close(fds[1]);
+
+  hogwork = jobs = worst = total = 0;
+  while(read(fds[0], &r, sizeof(r)) == sizeof(r)){
+    if(r.kind == 0){
+      hogwork += r.work;
+    } else {
+      jobs += r.work;
+      total += r.total;
+      if(r.worst > worst)
+        worst = r.worst;
+    }
+  }
+  for(i = 0; i < n; i++)
+    wait();
+
+  getschedstat(&st);
+  printf(1, "schedscale: %d cpus, %d hogs, %d interactive, %d ticks\n",
+         st.ncpu, nhogs, nint, len);
+  printf(1, "  hog throughput: %d chunks (%d per 100 ticks, %d per cpu)\n",
+         hogwork, hogwork * 100 / len, hogwork * 100 / len / st.ncpu);
+  printf(1, "  interactive: %d jobs, avg response %d/%d ticks, worst %d ticks\n",
+         jobs, total, jobs, worst);
+  exit();
+}
@@ -0,0 +1,82 @@
+// Print the scheduler counters from getschedstat().
+// With a command, run it and print how much each counter
+// moved while it ran.
+//
+// usage: schedstat [cmd [args ...]]
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "proc_type.h"
+
+void
+show(struct schedstat *st, int dt)
+{
+  struct schedconf conf;
+  int c;
+
+  schedconf(&conf, 0);
+
+  printf(1, "wakeups %d woken %d scanned %d\n",
+         st->wakeups, st->woken, st->wakeup_scanned);
+  if(st->wakeups > 0)
+    printf(1, "  %d scanned/wakeup, %d woken per 100 wakeups\n",
+           st->wakeup_scanned / st->wakeups, st->woken * 100 / st->wakeups);
+  printf(1, "context switches %d, reschedule IPIs %d\n", st->nswitch, st->ipis);
+  printf(1, "tickless %s\n", st->tickless ? "on" : "off");
+  for(c = 0; c < st->ncpu; c++){
+    printf(1, "cpu%d: %d ticks, %d idle, %d timer interrupts", c,
+           st->cpu_ticks[c], st->cpu_idle[c], st->cpu_intr[c]);
+    if(st->cpu_ticks[c] > 0)
+      printf(1, ", %d%% busy",
+             (st->cpu_ticks[c] - st->cpu_idle[c]) * 100 / st->cpu_ticks[c]);
+    if(dt > 0)
+      printf(1, ", %d interrupts/sec", st->cpu_intr[c] * conf.hz / dt);
+    printf(1, "\n");
+  }
+  if(dt > 0)
+    printf(1, "  over %d ticks, %d switches/sec\n", dt, st->nswitch * conf.hz / dt);
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct schedstat a, b;
+  int c, t0, pid;
+
+  if(getschedstat(&a) < 0){
+    printf(2, "schedstat: getschedstat failed\n");
+    exit();
+  }
+  if(argc < 2){
+    show(&a, 0);
+    exit();
+  }
+
+  t0 = uptime();
+  pid = fork();
+  if(pid < 0){
+    printf(2, "schedstat: fork failed\n");
+    exit();
+  }
+  if(pid == 0){
+    exec(argv[1], argv + 1);
+    printf(2, "schedstat: exec %s failed\n", argv[1]);
+    exit();
+  }
+  wait();
+  getschedstat(&b);
+
+  b.wakeups -= a.wakeups;
+  b.woken -= a.woken;
+  b.wakeup_scanned -= a.wakeup_scanned;
+  b.nswitch -= a.nswitch;
+  b.ipis -= a.ipis;
+  for(c = 0; c < b.ncpu; c++){
+    b.cpu_ticks[c] -= a.cpu_ticks[c];
+    b.cpu_idle[c] -= a.cpu_idle[c];
+    b.cpu_intr[c] -= a.cpu_intr[c];
+  }
+  show(&b, uptime() - t0);
+  exit();
+}
@@ -0,0 +1,244 @@
+// Scheduler trace viewer.
+// Turns on the kernel's scheduler trace (see trace.c), runs
+// command, then drains the per-CPU rings and prints
+//  - a timeline, one row per process and one column per tick:
+//    the MLFQ level while it ran, '.' while it waited on a run
+//    queue, blank otherwise;
+//  - per level, how long processes ran and waited there (in
+//    units of 1024 TSC cycles) and how often they were switched
+//    in, enqueued and demoted into it.
+//
+// usage: schedtrace command [arg ...]
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "proc_type.h"
+
+#define MAXP 32      // processes shown
+#define MAXCOL 640   // ticks shown
+#define WIDTH 64     // ticks per timeline row
+#define NLEVEL 4
+
+enum { NONE, QUEUED, RUNNING };
+
+struct pstate {
+  int pid;
+  int state;
+  int level;
+  uint tick;
+  uint64 tsc;
+};
+
+struct tevent *ev;
+int nev;
+struct pstate procs[MAXP];
+int np;
+char grid[MAXP][MAXCOL];
+uint t0;
+int ncol;
+
+uint runk[NLEVEL], waitk[NLEVEL];
+int nswitch[NLEVEL], nenq[NLEVEL], ndemote[NLEVEL];
+int nwake, nyield;
+
+int
+before(struct tevent *a, struct tevent *b)
+{
+  if(a->tick != b->tick)
+    return a->tick < b->tick;
+  return a->tsc < b->tsc;
+}
+
+// The rings come out one CPU at a time; interleave them.
+void
+sortevents(void)
+{
+  struct tevent t;
+  int gap, i, j;
+
+  for(gap = nev / 2; gap > 0; gap /= 2){
+    for(i = gap; i < nev; i++){
+      t = ev[i];
+      for(j = i; j >= gap && before(&t, &ev[j-gap]); j -= gap)
+        ev[j] = ev[j-gap];
+      ev[j] = t;
+    }
+  }
+}
+
+struct pstate*
+lookup(int pid)
+{
+  int i;
+
+  for(i = 0; i < np; i++)
+    if(procs[i].pid == pid)
+      return &procs[i];
+  if(np == MAXP)
+    return 0;
+  procs[np].pid = pid;
+  procs[np].state = NONE;
+  memset(grid[np], ' ', MAXCOL);
+  return &procs[np++];
+}
+
+int
+inlevel(int level)
+{
+  return level >= 0 && level < NLEVEL;
+}
+
+// Account for the time s spent in its current state, up to e.
+void
+leave(struct pstate *s, struct tevent *e)
+{
+  uint t;
+  uint k;
+  char c;
+
+  if(s->state == NONE)
+    return;
+  k = (uint)((e->tsc - s->tsc) >> 10);
+  if(s->state == QUEUED)
+    c = '.';
+  else
+    c = inlevel(s->level) ? '0' + s->level : '*';
+  for(t = s->tick; t <= e->tick; t++){
+    if(t - t0 >= ncol)
+      break;
+    if(c != '.' || grid[s - procs][t - t0] == ' ')
+      grid[s - procs][t - t0] = c;
+  }
+  if(!inlevel(s->level))
+    return;
+  if(s->state == RUNNING)
+    runk[s->level] += k;
+  else
+    waitk[s->level] += k;
+}
+
+void
+enter(struct pstate *s, struct tevent *e, int state, int level)
+{
+  leave(s, e);
+  s->state = state;
+  s->level = level;
+  s->tick = e->tick;
+  s->tsc = e->tsc;
+}
+
+void
+replay(void)
+{
+  struct tevent *e;
+  struct pstate *s;
+  int i;
+
+  for(i = 0; i < nev; i++){
+    e = &ev[i];
+    if((s = lookup(e->pid)) == 0)
+      continue;
+    switch(e->type){
+    case TR_SWITCHIN:
+      enter(s, e, RUNNING, e->arg);
+      if(inlevel(e->arg))
+        nswitch[e->arg]++;
+      break;
+    case TR_SWITCHOUT:
+      enter(s, e, NONE, 0);
+      break;
+    case TR_ENQUEUE:
+      enter(s, e, QUEUED, e->arg);
+      if(inlevel(e->arg))
+        nenq[e->arg]++;
+      break;
+    case TR_DEMOTE:
+      if(inlevel(e->arg))
+        ndemote[e->arg]++;
+      break;
+    case TR_WAKEUP:
+      nwake++;
+      break;
+    case TR_YIELD:
+      nyield++;
+      break;
+    }
+  }
+  for(i = 0; i < np; i++)
+    leave(&procs[i], &ev[nev-1]);
+}
+
+void
+timeline(void)
+{
+  int c, i, w;
+
+  for(c = 0; c < ncol; c += WIDTH){
+    w = ncol - c < WIDTH ? ncol - c : WIDTH;
+    printf(1, "tick %d\n", t0 + c);
+    for(i = 0; i < np; i++){
+      printf(1, "%d\t|", procs[i].pid);
+      write(1, grid[i] + c, w);
+      printf(1, "|\n");
+    }
+  }
+}
+
+void
+summary(void)
+{
+  int l;
+
+  printf(1, "level\trun\twait\tswitch\tenqueue\tdemoted\n");
+  for(l = 0; l < NLEVEL; l++)
+    printf(1, "%d\t%d\t%d\t%d\t%d\t%d\n", l, runk[l], waitk[l],
+           nswitch[l], nenq[l], ndemote[l]);
+  printf(1, "wakeups %d, yields %d\n", nwake, nyield);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int max, n, dropped, pid;
+
+  if(argc < 2){
+    printf(2, "usage: schedtrace command [arg ...]\n");
+    exit();
+  }
+  max = NCPU * TRACESIZE;
+  if((ev = malloc(max * sizeof(*ev))) == 0){
+    printf(2, "schedtrace: out of memory\n");
+    exit();
+  }
+
+  settrace(1);
+  pid = fork();
+  if(pid < 0){
+    printf(2, "schedtrace: fork failed\n");
+    exit();
+  }
+  if(pid == 0){
+    exec(argv[1], argv + 1);
+    printf(2, "schedtrace: exec %s failed\n", argv[1]);
+    exit();
+  }
+  wait();
+  dropped = settrace(0);
+  while(nev < max && (n = traceread(ev + nev, max - nev)) > 0)
+    nev += n;
+
+  printf(1, "schedtrace: %d events, %d dropped\n", nev, dropped);
+  if(nev == 0)
+    exit();
+  sortevents();
+  t0 = ev[0].tick;
+  ncol = ev[nev-1].tick - t0 + 1;
+  if(ncol > MAXCOL)
+    ncol = MAXCOL;
+  replay();
+  timeline();
+  summary();
+  exit();
+}
@@ -0,0 +1,19 @@
+// PA #2
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+int main(int argc, char** argv) {
+	int old;
+	
+	if (argc < 2) {
+		printf(2, "boost period: %d ticks\n", setboost(-1));
+		exit();
+	}
+	
+	old = setboost(atoi(argv[1]));
+	printf(2, "boost period: %d -> %d ticks\n", old, atoi(argv[1]));
+	
+	exit();
+}
@@ -0,0 +1,35 @@
+// PA #2
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "proc_type.h"
+
+static char *policies[] = {
+	[SCHED_MLFQ]	"mlfq",
+	[SCHED_RR]	"rr",
+	[SCHED_STRIDE]	"stride",
+};
+#define NPOLICY	(int)(sizeof(policies) / sizeof(policies[0]))
+
+int main(int argc, char** argv) {
+	int i, old;
+	
+	if (argc < 2) {
+		printf(2, "policy: %s\n", policies[setsched(-1)]);
+		exit();
+	}
+	
+	for (i = 0; i < NPOLICY; i++) {
+		if (strcmp(argv[1], policies[i]) == 0) {
+			break;
+		}
+	}
+	if (i == NPOLICY || (old = setsched(i)) < 0) {
+		printf(2, "usage: setsched [mlfq|rr|stride]\n");
+		exit();
+	}
+	printf(2, "policy: %s -> %s\n", policies[old], policies[i]);
+	
+	exit();
+}
@@ -0,0 +1,54 @@
+// Park 50 processes in sleep(1000) and report how many
+// context switches per second the idle system takes while
+// they wait.  Each sleeper should be woken exactly once, when
+// its deadline expires, not on every clock tick.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "proc_type.h"
+
+#define NSLEEPERS 50
+#define WINDOW 300   // ticks to measure over, well inside 1000
+
+int
+main(int argc, char *argv[])
+{
+  struct schedstat a, b;
+  struct schedconf conf;
+  int i, n, pid, t0, dt, rate;
+
+  schedconf(&conf, 0);
+  printf(1, "sleeptest: parking %d sleepers\n", NSLEEPERS);
+  for(n = 0; n < NSLEEPERS; n++){
+    pid = fork();
+    if(pid < 0)
+      break;
+    if(pid == 0){
+      sleep(1000);
+      exit();
+    }
+  }
+  if(n < NSLEEPERS)
+    printf(1, "sleeptest: only %d forks succeeded\n", n);
+
+  // Let the sleepers settle before measuring.
+  sleep(10);
+  getschedstat(&a);
+  t0 = uptime();
+  sleep(WINDOW);
+  dt = uptime() - t0;
+  getschedstat(&b);
+
+  rate = (b.nswitch - a.nswitch) * conf.hz / dt;
+  printf(1, "sleeptest: %d switches, %d woken in %d ticks: %d switches/sec\n",
+         b.nswitch - a.nswitch, b.woken - a.woken, dt, rate);
+
+  for(i = 0; i < n; i++)
+    wait();
+  if(rate < NSLEEPERS)
+    printf(1, "sleeptest ok\n");
+  else
+    printf(1, "sleeptest: FAILED, sleepers are being woken early\n");
+  exit();
+}
@@ -7,5 +7,10 @@ struct spinlock {
   struct cpu *cpu;   // The cpu holding the lock.
   uint pcs[10];      // The call stack (an array of program counters)
                      // that locked the lock.
+
+  // Contention counters, updated with the lock held.
+  uint nacquire;     // Times acquired
+  uint ncontend;     // ... of which it was held by another CPU
+  uint nspin;        // Failed attempts spent waiting for it
 };
 
@@ -0,0 +1,141 @@
+// Stride scheduling class.
+// Each process holds tickets set by its nice value, 0..39
+// (default 20), using the same 1.25x-per-step weights as
+// Linux nice -20..19.  For every tick it runs, its pass
+// advances by STRIDE1 / tickets, and the queued process with
+// the lowest pass runs next, so over any window runnable
+// processes get the CPU in proportion to their tickets.
+// Passes are compared as signed differences so they may wrap.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "proc_type.h"
+#include "sched.h"
+
+#define STRIDE1 (1 << 22)
+#define NICE_MAX 39
+
+#define BEFORE(a, b) ((int)((a) - (b)) < 0)
+
+static const int tickets[NICE_MAX+1] = {
+  /*  0 */ 88761, 71755, 56483, 46273, 36291,
+  /*  5 */ 29154, 23254, 18705, 14949, 11916,
+  /* 10 */  9548,  7620,  6100,  4904,  3906,
+  /* 15 */  3121,  2501,  1991,  1586,  1277,
+  /* 20 */  1024,   820,   655,   526,   423,
+  /* 25 */   335,   272,   215,   172,   137,
+  /* 30 */   110,    87,    70,    56,    45,
+  /* 35 */    36,    29,    23,    18,    15,
+};
+
+static uint
+stride_of(struct proc *p)
+{
+  return STRIDE1 / tickets[p->snice];
+}
+
+// Keep the queue sorted by pass, FIFO among equals.  A process
+// that slept, or was stolen from another CPU, has a pass from
+// another point in time; clamp it to within one stride of
+// this queue's so it neither monopolizes the CPU nor starves.
+static void
+stride_enqueue(struct runq *rq, struct proc *p)
+{
+  struct proc *q;
+
+  if(BEFORE(p->pass, rq->stride_pass))
+    p->pass = rq->stride_pass;
+  else if(BEFORE(rq->stride_pass + stride_of(p), p->pass))
+    p->pass = rq->stride_pass + stride_of(p);
+  for(q = front(&rq->stride); q; q = q->qnext)
+    if(BEFORE(p->pass, q->pass))
+      break;
+  if(q)
+    enque_before(&rq->stride, q, p);
+  else
+    enque(&rq->stride, p);
+  p->qlevel = 0;
+}
+
+static void
+stride_dequeue(struct runq *rq, struct proc *p)
+{
+  deque_proc(&rq->stride, p);
+}
+
+static struct proc*
+stride_pick_next(struct runq *rq)
+{
+  struct proc *p;
+
+  if((p = deque(&rq->stride)) != 0)
+    rq->stride_pass = p->pass;
+  return p;
+}
+
+static struct proc*
+stride_peek(struct runq *rq)
+{
+  return front(&rq->stride);
+}
+
+static int
+stride_tick(struct proc *p)
+{
+  p->pass += stride_of(p);
+  p->timeslice++;
+  return 1;
+}
+
+static uint64
+stride_slice_end(struct proc *p)
+{
+  return tick2tsc(tsc2ticks(rdtsc()) + 1);
+}
+
+static void
+stride_yield(struct proc *p)
+{
+}
+
+// Let the running process finish its tick.
+static int
+stride_preempt(struct proc *running, struct proc *p)
+{
+  return 0;
+}
+
+static int
+stride_setnice(struct proc *p, int value)
+{
+  if(value < 0 || value > NICE_MAX)
+    return -1;
+  p->snice = value;
+  return 0;
+}
+
+static int
+stride_getnice(struct proc *p)
+{
+  return p->snice;
+}
+
+struct sched_class stride_class = {
+  .name = "stride",
+  .policy = SCHED_STRIDE,
+  .enqueue = stride_enqueue,
+  .dequeue = stride_dequeue,
+  .pick_next = stride_pick_next,
+  .peek = stride_peek,
+  .tick = stride_tick,
+  .slice_end = stride_slice_end,
+  .yield = stride_yield,
+  .preempt = stride_preempt,
+  .setnice = stride_setnice,
+  .getnice = stride_getnice,
+};
@@ -0,0 +1,138 @@
+// Stride scheduling share test.
+// Switches to the stride class, runs CPU hogs at different
+// nice values for a fixed window, and checks that hogs on the
+// same CPU split it in proportion to their tickets, to within
+// TOLERANCE percentage points.  Run queues are per CPU, so
+// shares only hold between hogs that share one: the test runs
+// one more hog than there are CPUs, samples where each runs
+// every SAMPLE ticks, and compares each pair of hogs over the
+// samples they spent on the same CPU.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "proc_type.h"
+
+#define NNICE 3
+#define MAXHOG 16
+#define WINDOW 1000     // ticks
+#define SAMPLE 10       // ticks
+#define MINPAIR 100     // ticks two hogs must share a CPU for
+#define TOLERANCE 3     // percentage points
+
+int nices[NNICE] = { 20, 25, 30 };
+int tickets[NNICE] = { 1024, 335, 110 };  // from stride.c
+
+#define CHUNK 16
+struct pinfo info[CHUNK];
+int nhog;
+int pids[MAXHOG];
+int old;                // scheduler to restore
+
+// pair[i][j]: ticks hog i ran while it shared a CPU with hog j.
+int pair[MAXHOG][MAXHOG];
+
+void
+stop(void)
+{
+  int i;
+
+  for(i = 0; i < nhog; i++){
+    kill(pids[i]);
+    wait();
+  }
+  setsched(old);
+}
+
+// Read the ticks and CPU of each hog from the whole process
+// table; a hog may sit in any slot.  Fails the test if one is
+// missing.
+void
+hogticks(int *ticks, int *cpus)
+{
+  int i, j, n, slot, found;
+
+  found = 0;
+  slot = 0;
+  while((n = procinfo(slot, info, CHUNK)) > 0){
+    for(i = 0; i < n; i++)
+      for(j = 0; j < nhog; j++)
+        if(info[i].pid == pids[j]){
+          ticks[j] = info[i].ticks;
+          cpus[j] = info[i].cpu;
+          found++;
+        }
+    slot = info[n - 1].slot + 1;
+  }
+  if(n < 0 || found != nhog){
+    printf(1, "stridetest: FAILED, hogs not found by procinfo\n");
+    stop();
+    exit();
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct schedstat st;
+  int t0[MAXHOG], c0[MAXHOG], t1[MAXHOG], c1[MAXHOG];
+  int i, j, t, a, b, want, share, npair, ok;
+
+  getschedstat(&st);
+  nhog = st.ncpu + 1;
+  if(nhog < NNICE)
+    nhog = NNICE;
+  if(nhog > MAXHOG)
+    nhog = MAXHOG;
+
+  old = setsched(SCHED_STRIDE);
+  for(i = 0; i < nhog; i++){
+    if((pids[i] = fork()) == 0){
+      for(;;)
+        ;
+    }
+    setnice(pids[i], nices[i % NNICE]);
+  }
+
+  sleep(10);
+  hogticks(t0, c0);
+  for(t = 0; t < WINDOW; t += SAMPLE){
+    sleep(SAMPLE);
+    hogticks(t1, c1);
+    // Count only hogs that were on the same CPU at both ends.
+    for(i = 0; i < nhog; i++)
+      for(j = 0; j < nhog; j++)
+        if(i != j && c0[i] == c1[i] && c0[j] == c1[j] && c1[i] == c1[j])
+          pair[i][j] += t1[i] - t0[i];
+    for(i = 0; i < nhog; i++){
+      t0[i] = t1[i];
+      c0[i] = c1[i];
+    }
+  }
+  stop();
+
+  npair = 0;
+  ok = 1;
+  for(i = 0; i < nhog; i++){
+    for(j = i + 1; j < nhog; j++){
+      a = pair[i][j];
+      b = pair[j][i];
+      if(a + b < MINPAIR)
+        continue;
+      npair++;
+      want = tickets[i % NNICE] * 100 /
+             (tickets[i % NNICE] + tickets[j % NNICE]);
+      share = a * 100 / (a + b);
+      printf(1, "nice %d vs %d: %d to %d ticks, %d%% (want %d%%)\n",
+             nices[i % NNICE], nices[j % NNICE], a, b, share, want);
+      if(share < want - TOLERANCE || share > want + TOLERANCE)
+        ok = 0;
+    }
+  }
+  if(npair == 0){
+    printf(1, "stridetest: FAILED, no hogs shared a CPU\n");
+    exit();
+  }
+  printf(1, ok ? "stridetest ok\n" : "stridetest: FAILED\n");
+  exit();
+}
@@ -3,6 +3,7 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
 #include "x86.h"
 #include "syscall.h"
@@ -19,6 +20,8 @@ fetchint(uint addr, int *ip)
 {
   if(addr >= proc->sz || addr+4 > proc->sz)
     return -1;
+  if(uvmtouch(proc, addr, 4, 0) < 0)
+    return -1;
   *ip = *(int*)(addr);
   return 0;
 }
@@ -35,9 +38,13 @@ fetchstr(uint addr, char **pp)
     return -1;
   *pp = (char*)addr;
   ep = (char*)proc->sz;
-  for(s = *pp; s < ep; s++)
+  for(s = *pp; s < ep; s++){
+    if((s == *pp || (uint)s % PGSIZE == 0) &&
+       uvmtouch(proc, (uint)s, 1, 0) < 0)
+      return -1;
     if(*s == 0)
       return s - *pp;
+  }
   return -1;
 }
 
@@ -50,9 +57,10 @@ argint(int n, int *ip)
 
 // Fetch the nth word-sized system call argument as a pointer
 // to a block of memory of size bytes.  Check that the pointer
-// lies within the process address space.
+// lies within the process address space, and that the block
+// is writable if the system call will write to it.
 int
-argptr(int n, char **pp, int size)
+argptr(int n, char **pp, int size, int write)
 {
   int i;
 
@@ -60,6 +68,8 @@ argptr(int n, char **pp, int size)
     return -1;
   if(size < 0 || (uint)i >= proc->sz || (uint)i+size > proc->sz)
     return -1;
+  if(uvmtouch(proc, i, size, write) < 0)
+    return -1;
   *pp = (char*)i;
   return 0;
 }
@@ -108,6 +118,18 @@ extern int sys_setnice(void);
 
 // PA #2
 extern int sys_getpinfo(void);
+extern int sys_setboost(void);
+extern int sys_getschedstat(void);
+extern int sys_setsched(void);
+extern int sys_reserve(void);
+extern int sys_settrace(void);
+extern int sys_traceread(void);
+extern int sys_procinfo(void);
+extern int sys_settickless(void);
+extern int sys_schedconf(void);
+extern int sys_waitpid(void);
+extern int sys_getlockstat(void);
+extern int sys_getvmstat(void);
 
 static int (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -141,6 +163,18 @@ static int (*syscalls[])(void) = {
 
 // PA #2
 [SYS_getpinfo]	sys_getpinfo,
+[SYS_setboost]	sys_setboost,
+[SYS_getschedstat]	sys_getschedstat,
+[SYS_setsched]	sys_setsched,
+[SYS_reserve]	sys_reserve,
+[SYS_settrace]	sys_settrace,
+[SYS_traceread]	sys_traceread,
+[SYS_procinfo]	sys_procinfo,
+[SYS_settickless]	sys_settickless,
+[SYS_schedconf]	sys_schedconf,
+[SYS_waitpid]	sys_waitpid,
+[SYS_getlockstat]	sys_getlockstat,
+[SYS_getvmstat]	sys_getvmstat,
 };
 
 void
@@ -28,4 +28,16 @@
 #define SYS_setnice	26
 
 // PA #2
-#define SYS_getpinfo	27
\ No newline at end of file
+#define SYS_getpinfo	27
+#define SYS_setboost	28
+#define SYS_getschedstat	29
+#define SYS_setsched	30
+#define SYS_reserve	31
+#define SYS_settrace	32
+#define SYS_traceread	33
+#define SYS_procinfo	34
+#define SYS_settickless	35
+#define SYS_schedconf	36
+#define SYS_waitpid	37
+#define SYS_getlockstat	38
+#define SYS_getvmstat	39
@@ -5,7 +5,9 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
+#include "proc_type.h"
 
 int
 sys_fork(void)
@@ -26,6 +28,16 @@ sys_wait(void)
   return wait();
 }
 
+int
+sys_waitpid(void)
+{
+  int pid, options;
+
+  if(argint(0, &pid) < 0 || argint(1, &options) < 0)
+    return -1;
+  return waitpid(pid, options);
+}
+
 int
 sys_kill(void)
 {
@@ -60,21 +72,10 @@ int
 sys_sleep(void)
 {
   int n;
-  uint ticks0;
 
   if(argint(0, &n) < 0)
     return -1;
-  acquire(&tickslock);
-  ticks0 = ticks;
-  while(ticks - ticks0 < n){
-    if(proc->killed){
-      release(&tickslock);
-      return -1;
-    }
-    sleep(&ticks, &tickslock);
-  }
-  release(&tickslock);
-  return 0;
+  return sleepticks(n);
 }
 
 // return how many clock tick interrupts have occurred
@@ -85,6 +86,7 @@ sys_uptime(void)
   uint xticks;
 
   acquire(&tickslock);
+  tickupdate();
   xticks = ticks;
   release(&tickslock);
   return xticks;
@@ -109,7 +111,7 @@ int sys_ps(void)
 {
 	int n;
 	struct ps_info *info_ptr;
-	if(argint(1, (int*)&info_ptr) < 0)
+	if(argptr(1, (char**)&info_ptr, sizeof(*info_ptr), 1) < 0)
 	{
 		return -1;
 	}
@@ -146,9 +148,132 @@ int sys_setnice(void)
 int sys_getpinfo()
 {
 	struct pstat *ptr;
-	if(argint(0, (int*)&ptr) < 0)
+	if(argptr(0, (char**)&ptr, sizeof(*ptr), 1) < 0)
 	{
 		return -1;
 	}
 	return getpinfo(ptr);
-}
\ No newline at end of file
+}
+
+int sys_setboost(void)
+{
+	int period;
+	if(argint(0, &period) < 0)
+	{
+		return -1;
+	}
+	return setboost(period);
+}
+
+int sys_getschedstat(void)
+{
+	struct schedstat *st;
+	if(argptr(0, (char**)&st, sizeof(*st), 1) < 0)
+	{
+		return -1;
+	}
+	return getschedstat(st);
+}
+
+int sys_setsched(void)
+{
+	int policy;
+	if(argint(0, &policy) < 0)
+	{
+		return -1;
+	}
+	return setsched(policy);
+}
+
+int sys_reserve(void)
+{
+	int pid, runtime, period;
+	if(argint(0, &pid) < 0 || argint(1, &runtime) < 0 || argint(2, &period) < 0)
+	{
+		return -1;
+	}
+	return reserve(pid, runtime, period);
+}
+
+int sys_settrace(void)
+{
+	int on;
+	if(argint(0, &on) < 0)
+	{
+		return -1;
+	}
+	return settrace(on);
+}
+
+int sys_traceread(void)
+{
+	struct tevent *buf;
+	int n;
+	if(argint(1, &n) < 0 || n < 0)
+	{
+		return -1;
+	}
+	// No more can be buffered; also keeps n * sizeof(*buf) from wrapping.
+	if(n > NCPU * TRACESIZE)
+		n = NCPU * TRACESIZE;
+	if(argptr(0, (char**)&buf, n * sizeof(*buf), 1) < 0)
+	{
+		return -1;
+	}
+	return traceread(buf, n);
+}
+
+int sys_procinfo(void)
+{
+	int start, n;
+	struct pinfo *buf;
+	if(argint(0, &start) < 0 || argint(2, &n) < 0 || n < 0 || n > NPROC ||
+	   argptr(1, (char**)&buf, n * sizeof(*buf), 1) < 0)
+	{
+		return -1;
+	}
+	return procinfo(start, buf, n);
+}
+
+int sys_settickless(void)
+{
+	int on;
+	if(argint(0, &on) < 0)
+	{
+		return -1;
+	}
+	return settickless(on);
+}
+
+int sys_schedconf(void)
+{
+	struct schedconf *c;
+	int set;
+	if(argptr(0, (char**)&c, sizeof(*c), 1) < 0 || argint(1, &set) < 0)
+	{
+		return -1;
+	}
+	return schedconf(c, set);
+}
+
+int sys_getlockstat(void)
+{
+	struct lockstat *ls;
+	int n;
+	if(argint(1, &n) < 0 || n < 0 || n > NLOCKSTAT ||
+	   argptr(0, (char**)&ls, n * sizeof(*ls), 1) < 0)
+	{
+		return -1;
+	}
+	return getlockstat(ls, n);
+}
+
+int sys_getvmstat(void)
+{
+	struct vmstat *st;
+	if(argptr(0, (char**)&st, sizeof(*st), 1) < 0)
+	{
+		return -1;
+	}
+	return getvmstat(st);
+}
@@ -4,6 +4,7 @@
 
 #include "types.h"
 #include "defs.h"
+#include "param.h"
 #include "traps.h"
 #include "x86.h"
 
@@ -21,12 +22,134 @@
 #define TIMER_RATEGEN   0x04    // mode 2, rate generator
 #define TIMER_16BIT     0x30    // r/w counter 16 bits, LSB first
 
+#define TIMER_SEL2      0x80    // select counter 2
+#define TIMER_INTTC     0x00    // mode 0, interrupt on terminal count
+#define PORTB           0x61    // counter 2 gate (bit 0) and output (bit 5)
+
+uint tsckhz;                    // TSC cycles per millisecond
+uint hz = HZ;                   // Clock ticks per second
+uint tscpertick;                // TSC cycles per clock tick
+
+// The clock: tick clocktick began at TSC clocktsc, and one
+// follows every tscpertick cycles.  sethz() moves the base;
+// readers retry if clockseq was odd or changed meanwhile.
+static uint64 clocktsc;
+static uint clocktick;
+static volatile uint clockseq;
+
+static void
+pitrate(uint rate)
+{
+  outb(TIMER_MODE, TIMER_SEL0 | TIMER_RATEGEN | TIMER_16BIT);
+  outb(IO_TIMER1, TIMER_DIV(rate) % 256);
+  outb(IO_TIMER1, TIMER_DIV(rate) / 256);
+}
+
+// Time 10ms on PIT counter 2, which runs at TIMER_FREQ on
+// every machine, to learn the TSC rate.  The clock, ticks,
+// counts from here on; see tsc2ticks().
+void
+tsccalibrate(void)
+{
+  uint64 t0, t1;
+
+  // Gate counter 2 on, speaker off.
+  outb(PORTB, (inb(PORTB) & ~0x02) | 0x01);
+  outb(TIMER_MODE, TIMER_SEL2 | TIMER_INTTC | TIMER_16BIT);
+  outb(IO_TIMER1+2, TIMER_DIV(100) % 256);
+  outb(IO_TIMER1+2, TIMER_DIV(100) / 256);
+  t0 = rdtsc();
+  while((inb(PORTB) & 0x20) == 0)
+    ;
+  t1 = rdtsc();
+  tsckhz = (uint)(t1 - t0) / 10;
+  if(tsckhz == 0)
+    tsckhz = 1;
+  tscpertick = divl((uint64)tsckhz * 1000, hz, 0);
+  clocktsc = t1;
+}
+
+// The tick that TSC value tsc falls in.
+uint
+tsc2ticks(uint64 tsc)
+{
+  uint s, t;
+  uint64 d;
+
+  do {
+    while((s = clockseq) & 1)
+      ;
+    __sync_synchronize();
+    d = tsc - clocktsc;
+    if((long long)d < 0)
+      t = clocktick;
+    else if((d >> 32) >= tscpertick)
+      t = ~0;
+    else
+      t = clocktick + divl(d, tscpertick, 0);
+    __sync_synchronize();
+  } while(clockseq != s);
+  return t;
+}
+
+// The TSC value at which tick t begins.
+uint64
+tick2tsc(uint t)
+{
+  uint s;
+  uint64 tsc;
+
+  do {
+    while((s = clockseq) & 1)
+      ;
+    __sync_synchronize();
+    tsc = clocktsc + (long long)(int)(t - clocktick) * tscpertick;
+    __sync_synchronize();
+  } while(clockseq != s);
+  return tsc;
+}
+
+// Change the tick rate to rate per second.  ticks carries on
+// from its current value, counting faster or slower.
+// Caller must hold tickslock.
+void
+sethz(uint rate)
+{
+  uint64 now;
+  uint t;
+
+  now = rdtsc();
+  t = tsc2ticks(now);
+  clockseq++;
+  __sync_synchronize();
+  clocktsc = now;
+  clocktick = t;
+  hz = rate;
+  tscpertick = divl((uint64)tsckhz * 1000, rate, 0);
+  __sync_synchronize();
+  clockseq++;
+  if(!ismp)
+    pitrate(rate);
+}
+
+// Convert TSC cycles to microseconds, saturating at ~0.
+uint
+tsc2us(uint64 cycles)
+{
+  uint ms, r;
+
+  if((cycles >> 32) >= tsckhz)
+    return ~0;
+  ms = divl(cycles, tsckhz, &r);
+  if(ms >= 0xFFFFFFFF / 1000)
+    return ~0;
+  return ms * 1000 + divl((uint64)r * 1000, tsckhz, 0);
+}
+
 void
 timerinit(void)
 {
-  // Interrupt 100 times/sec.
-  outb(TIMER_MODE, TIMER_SEL0 | TIMER_RATEGEN | TIMER_16BIT);
-  outb(IO_TIMER1, TIMER_DIV(100) % 256);
-  outb(IO_TIMER1, TIMER_DIV(100) / 256);
+  // Interrupt hz times/sec.
+  pitrate(hz);
   picenable(IRQ_TIMER);
 }
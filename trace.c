@@ -0,0 +1,137 @@
+// Scheduler event trace.
+// Each CPU records into its own ring with interrupts off, so a
+// ring has a single writer and the writer takes no lock: it
+// fills the slot at head, then advances head.  traceread()
+// consumes from tail up to head; readers serialize among
+// themselves on tracelock.  A full ring drops new events
+// rather than overwrite ones a reader may be copying out.
+//
+// settrace() cannot empty a ring whose CPU may be recording
+// into it, so it starts a new generation instead.  Each CPU
+// notices on its next event and marks where the new trace
+// begins in its ring; readers skip what came before, and
+// rings that have not caught up yet.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "proc_type.h"
+
+struct ring {
+  struct tevent ev[TRACESIZE];
+  volatile uint head;          // Next slot to fill; owning CPU only
+  volatile uint tail;          // Next slot to read; readers only
+  volatile uint base;          // First slot of this generation
+  volatile uint gen;           // Generation base belongs to
+  uint dropped;                // Events lost to a full ring
+};
+
+static struct ring rings[NCPU];
+static struct spinlock tracelock;
+static volatile int tracing;
+static volatile uint tracegen;  // Bumped by settrace() to empty the rings
+
+// The first slot a reader may still need.
+static uint
+firstslot(struct ring *r)
+{
+  uint t;
+
+  t = r->tail;
+  if((int)(t - r->base) < 0)
+    t = r->base;
+  return t;
+}
+
+void
+traceinit(void)
+{
+  initlock(&tracelock, "trace");
+}
+
+// Record an event of type for p on this CPU.
+void
+trace(int type, struct proc *p, int arg)
+{
+  struct ring *r;
+  struct tevent *e;
+
+  if(!tracing)
+    return;
+  pushcli();
+  r = &rings[cpu - cpus];
+  if(r->gen != tracegen){
+    r->dropped = 0;
+    r->base = r->head;
+    __sync_synchronize();
+    r->gen = tracegen;
+  }
+  if(r->head - firstslot(r) >= TRACESIZE){
+    r->dropped++;
+  } else {
+    e = &r->ev[r->head % TRACESIZE];
+    e->tsc = rdtsc();
+    e->tick = ticks;
+    e->pid = p->pid;
+    e->type = type;
+    e->cpu = cpu - cpus;
+    e->arg = arg;
+    __sync_synchronize();
+    r->head++;
+  }
+  popcli();
+}
+
+// Turn tracing on (on > 0, emptying the rings) or off
+// (on == 0).  Returns the number of events dropped since
+// tracing was last turned on; a negative on only reads it.
+int
+settrace(int on)
+{
+  int c, n;
+
+  acquire(&tracelock);
+  n = 0;
+  for(c = 0; c < ncpu; c++)
+    if(rings[c].gen == tracegen)
+      n += rings[c].dropped;
+  if(on > 0){
+    tracegen++;
+    __sync_synchronize();
+    tracing = 1;
+  } else if(on == 0){
+    tracing = 0;
+  }
+  release(&tracelock);
+  return n;
+}
+
+// Move up to n recorded events, ring by ring, into buf and
+// return how many were moved.
+int
+traceread(struct tevent *buf, int n)
+{
+  struct ring *r;
+  int c, i;
+
+  acquire(&tracelock);
+  i = 0;
+  for(c = 0; c < ncpu; c++){
+    r = &rings[c];
+    if(r->gen != tracegen)
+      continue;
+    __sync_synchronize();
+    r->tail = firstslot(r);
+    while(i < n && r->tail != r->head){
+      buf[i++] = r->ev[r->tail % TRACESIZE];
+      __sync_synchronize();
+      r->tail++;
+    }
+  }
+  release(&tracelock);
+  return i;
+}
@@ -3,10 +3,10 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
 #include "x86.h"
 #include "traps.h"
-#include "spinlock.h"
 
 // Interrupt descriptor table (shared by all CPUs).
 struct gatedesc idt[256];
@@ -14,17 +14,38 @@ extern uint vectors[];  // in vectors.S: array of 256 entry pointers
 struct spinlock tickslock;
 uint ticks;
 
-// PA #2
-const int timeslices[4] = {1, 2, 4, 8};
-char* state_code2str[] = {"UNUSED", "EMBRYO", "SLEEPING", "RUNNABLE", "RUNNING", "ZOMBIE"};
-extern struct {
-  struct spinlock lock;
-  struct proc proc[NPROC];
-} ptable;
-#include "proc_type.h"
-extern queue mlfq[4];
-extern int is_runnable[NPROC];
-extern int test;
+// ticks follows the TSC (see tsc2ticks()) rather than
+// counting interrupts, since a tickless CPU does not take
+// them all.  Bring it up to date and wake the sleepers that
+// fell due.  Caller must hold tickslock.  Returns the old
+// value.
+uint
+tickupdate(void)
+{
+  uint old, now;
+
+  old = ticks;
+  now = tsc2ticks(rdtsc());
+  if((int)(now - old) > 0){
+    ticks = now;
+    timerq_expire();
+  }
+  return old;
+}
+
+// Ticks begun since this CPU last counted them, which may be
+// none if the timer was armed for a time within a tick.
+static int
+cputicks(void)
+{
+  uint t;
+  int n;
+
+  t = tsc2ticks(rdtsc());
+  n = t - cpu->lasttick;
+  cpu->lasttick = t;
+  return n > 0 ? n : 0;
+}
 
 void
 tvinit(void)
@@ -48,6 +69,12 @@ idtinit(void)
 void
 trap(struct trapframe *tf)
 {
+  uint old;
+  int n = 0;
+
+  if(proc && (tf->cs&3) == DPL_USER)
+    acct_user(proc);
+
   if(tf->trapno == T_SYSCALL){
     if(proc->killed)
       exit();
@@ -55,23 +82,36 @@ trap(struct trapframe *tf)
     syscall();
     if(proc->killed)
       exit();
+    if(cpu->needresched)
+      yield();
+    acct_kernel(proc);
     return;
   }
 
   switch(tf->trapno){
   case T_IRQ0 + IRQ_TIMER:
-    if(cpunum() == 0){
-      acquire(&tickslock);
-      ticks++;
-      wakeup(&ticks);
-      release(&tickslock);
-    }
+    cpu->nintr++;
+    n = cputicks();
+    cpu->nticks += n;
+    if(proc == 0)
+      cpu->idleticks += n;
+    acquire(&tickslock);
+    old = tickupdate();
+    release(&tickslock);
+    if(boost_period > 0 && old / boost_period != ticks / boost_period)
+      mlfq_boost();
     lapiceoi();
     break;
   case T_IRQ0 + IRQ_IDE:
     ideintr();
     lapiceoi();
     break;
+  case T_RESCHED:
+    // Another CPU queued work for us or a sleeper that CPU 0
+    // must wake for; an idle CPU is already out of hlt, a
+    // busy one yields or re-arms its timer below.
+    lapiceoi();
+    break;
   case T_IRQ0 + IRQ_IDE+1:
     // Bochs generates spurious IDE1 interrupts.
     break;
@@ -90,6 +130,21 @@ trap(struct trapframe *tf)
     lapiceoi();
     break;
 
+  case T_PGFLT:
+    // A touch of heap or program that is not mapped yet, or a
+    // write to a copy-on-write page, from user space or by the
+    // kernel on the process's behalf.  Anything else falls
+    // through to kill the process or panic.  pagein() may
+    // sleep, so the kernel must have no spinlock held; system
+    // calls page in user buffers up front (see argptr).
+    if(proc && !(tf->err & FEC_PR) &&
+       ((tf->cs&3) == DPL_USER || cpu->ncli == 0) &&
+       pagein(proc, rcr2()) == 0)
+      break;
+    if(proc && (tf->err & FEC_WR) && cowfault(proc->pgdir, rcr2()) == 0)
+      break;
+    // fall through
+
   //PAGEBREAK: 13
   default:
     if(proc == 0 || (tf->cs&3) == 0){
@@ -114,45 +169,25 @@ trap(struct trapframe *tf)
 
   // Force process to give up CPU on clock tick.
   // If interrupts were on while locks held, would need to check nlock.
-  //cprintf("%d %d %d\n", proc, proc && proc->state == RUNNING, tf->trapno == T_IRQ0+IRQ_TIMER);
-	if(proc && proc->state == RUNNING && tf->trapno == T_IRQ0+IRQ_TIMER)
-	{
-//  acquire(&ptable.lock);
-//  
-//  for (int i = 0; i < NPROC; i++){
-//	  if (ptable.proc[i].state == UNUSED) continue;
-//	  //if (ptable.proc[i].name[0] != 's') continue;
-//	  
-//	  cprintf(state_code2str[ptable.proc[i].state]);
-//	  cprintf(" proc: %d id: %d name: %s mlfq0: %s mlfq1: %s mlfq2: %s mlfq3: %s is_runnable: %d", 
-//	  proc, ptable.proc[i].pid,
-//	  ptable.proc[i].name,
-//	  empty(mlfq + 0) ? "empty":"filled",
-//	  empty(mlfq + 1) ? "empty":"filled",
-//	  empty(mlfq + 2) ? "empty":"filled",
-//	  empty(mlfq + 3) ? "empty":"filled",
-//	  is_runnable[i]);
-//	  cprintf("\n");
-//  }
-//  release(&ptable.lock);
-  
-		
-		proc->ticks++;
-		proc->timeslice++;
-//		cprintf("ticks: %d cur_tick: %d timeslice: %d\n", proc->ticks, proc->timeslice, timeslices[proc->niceness]);
-		if (proc->timeslice >= timeslices[proc->niceness])
-		{
-			//proc->timeslice = 0;
-//			cprintf("yield();\n");
-			yield();
-		}
-		
-//		yield();
-		// shouldn't use yield() when scheduling
-	}
-  
+  if(proc && proc->state == RUNNING && tf->trapno == T_IRQ0+IRQ_TIMER &&
+     sched_tick(proc, n))
+    yield();
+
+  // Let a more urgent process that another CPU, or this one,
+  // queued for us run now.
+  if(proc && proc->state == RUNNING && cpu->needresched)
+    yield();
+
+  // The one-shot timer has fired or CPU 0 has a new deadline
+  // to wake for: set it again for whoever runs now.
+  if(proc && proc->state == RUNNING &&
+     (tf->trapno == T_IRQ0+IRQ_TIMER || tf->trapno == T_RESCHED))
+    timerarm();
 
   // Check if the process has been killed since we yielded
   if(proc && proc->killed && (tf->cs&3) == DPL_USER)
     exit();
+
+  if(proc && (tf->cs&3) == DPL_USER)
+    acct_kernel(proc);
 }
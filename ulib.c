@@ -103,3 +103,12 @@ memmove(void *vdst, void *vsrc, int n)
     *dst++ = *src++;
   return vdst;
 }
+
+// Microseconds per op in TSC cycles d over n ops, at tsckhz
+// cycles per millisecond (see schedconf()).  Scaled down by
+// 1024 first, since there is no 64-bit division.
+uint
+usper(uint64 d, int n, uint tsckhz)
+{
+  return (uint)(d >> 10) / n * 1000 / ((tsckhz >> 10) + 1);
+}
@@ -6,11 +6,19 @@ struct ps_info;
 
 // PA #2
 struct pstat;
+struct pinfo;
+struct lockstat;
+struct schedstat;
+struct tevent;
+struct schedconf;
+struct vmstat;
 
 // system calls
 int fork(void);
 int exit(void) __attribute__((noreturn));
 int wait(void);
+int waitpid(int, int);
+int getlockstat(struct lockstat*, int);
 int pipe(int*);
 int write(int, void*, int);
 int read(int, void*, int);
@@ -40,6 +48,16 @@ int setnice(int, int);
 
 //PA #2
 int getpinfo(struct pstat*);
+int setboost(int);
+int getschedstat(struct schedstat*);
+int setsched(int);
+int reserve(int, int, int);
+int settrace(int);
+int traceread(struct tevent*, int);
+int procinfo(int, struct pinfo*, int);
+int settickless(int);
+int schedconf(struct schedconf*, int);
+int getvmstat(struct vmstat*);
 
 // ulib.c
 int stat(char*, struct stat*);
@@ -54,3 +72,4 @@ void* memset(void*, int, uint);
 void* malloc(uint);
 void free(void*);
 int atoi(const char*);
+uint usper(uint64, int, uint);
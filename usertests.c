@@ -1383,7 +1383,7 @@ forktest(void)
 
   printf(1, "fork test\n");
 
-  for(n=0; n<1000; n++){
+  for(n=0; n<NPROC+1; n++){
     pid = fork();
     if(pid < 0)
       break;
@@ -1391,8 +1391,8 @@ forktest(void)
       exit();
   }
 
-  if(n == 1000){
-    printf(1, "fork claimed to work 1000 times!\n");
+  if(n == NPROC+1){
+    printf(1, "fork claimed to work %d times!\n", n);
     exit();
   }
 
@@ -4,11 +4,14 @@
 #include "x86.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
 #include "elf.h"
+#include "proc_type.h"
 
 extern char data[];  // defined by kernel.ld
 pde_t *kpgdir;  // for use in scheduler()
+struct vmstat vmstat;
 
 // Set up CPU's kernel segment descriptors.
 // Run once on entry on each CPU.
@@ -133,6 +136,13 @@ setupkvm(void)
   if((pgdir = (pde_t*)kalloc()) == 0)
     return 0;
   memset(pgdir, 0, PGSIZE);
+  // The kernel's mappings never change after boot, so every
+  // process shares kpgdir's page tables for them.
+  if(kpgdir){
+    memmove(&pgdir[PDX(KERNBASE)], &kpgdir[PDX(KERNBASE)],
+            (NPDENTRIES - PDX(KERNBASE)) * sizeof(pde_t));
+    return pgdir;
+  }
   if (P2V(PHYSTOP) > (void*)DEVSPACE)
     panic("PHYSTOP too high");
   for(k = kmap; k < &kmap[NELEM(kmap)]; k++)
@@ -198,30 +208,103 @@ inituvm(pde_t *pgdir, char *init, uint sz)
   memmove(mem, init, sz);
 }
 
-// Load a program segment into pgdir.  addr must be page-aligned
-// and the pages from addr to addr+sz must already be mapped.
+// Back the page at va in page table pgdir with a zeroed page
+// if va lies below the process size sz but nothing is mapped
+// there yet, as sbrk() leaves the heap.  Returns 0 if the page is mapped, -1 if va
+// is beyond sz or there is no memory.
 int
-loaduvm(pde_t *pgdir, char *addr, struct inode *ip, uint offset, uint sz)
+lazyalloc(pde_t *pgdir, uint va, uint sz)
 {
-  uint i, pa, n;
   pte_t *pte;
+  char *mem;
 
-  if((uint) addr % PGSIZE != 0)
-    panic("loaduvm: addr must be page aligned");
-  for(i = 0; i < sz; i += PGSIZE){
-    if((pte = walkpgdir(pgdir, addr+i, 0)) == 0)
-      panic("loaduvm: address should exist");
-    pa = PTE_ADDR(*pte);
-    if(sz - i < PGSIZE)
-      n = sz - i;
-    else
-      n = PGSIZE;
-    if(readi(ip, P2V(pa), offset+i, n) != n)
+  if(va >= sz)
+    return -1;
+  pte = walkpgdir(pgdir, (char*)va, 0);
+  if(pte && (*pte & PTE_P))
+    return 0;
+  if((mem = kalloc()) == 0)
+    return -1;
+  memset(mem, 0, PGSIZE);
+  if(mappages(pgdir, (char*)PGROUNDDOWN(va), PGSIZE, V2P(mem), PTE_W|PTE_U) < 0){
+    kfree(mem);
+    return -1;
+  }
+  __sync_fetch_and_add(&vmstat.lazypages, 1);
+  return 0;
+}
+
+// Map the page at va of program segment s of process p.  A
+// page wholly within the file data is the executable's cached
+// page, shared with every process running the same program
+// and copied on the first write if the segment is writable.
+// The page holding the end of the file data is a private copy
+// zeroed past it.  Pages past the file data are zero pages.
+// Reads the executable, so may sleep.
+static int
+segpagein(struct proc *p, struct seg *s, uint va)
+{
+  uint a, o, n;
+  char *mem, *pg;
+  int perm;
+
+  a = PGROUNDDOWN(va);
+  o = a - s->va;
+  if(o >= s->filesz)
+    return lazyalloc(p->pgdir, va, p->sz);
+  ilock(p->exe);
+  pg = ipage(p->exe, s->off + o);
+  iunlock(p->exe);
+  if(pg == 0)
+    return -1;
+  if(o + PGSIZE <= s->filesz){
+    mem = pg;
+    perm = PTE_U | (s->writable ? PTE_COW : 0);
+  } else {
+    if((mem = kalloc()) == 0){
+      kfree(pg);
       return -1;
+    }
+    n = s->filesz - o;
+    memmove(mem, pg, n);
+    memset(mem + n, 0, PGSIZE - n);
+    kfree(pg);
+    perm = PTE_U | (s->writable ? PTE_W : 0);
+  }
+  if(mappages(p->pgdir, (char*)a, PGSIZE, V2P(mem), perm) < 0){
+    kfree(mem);
+    return -1;
   }
+  __sync_fetch_and_add(&vmstat.pageins, 1);
   return 0;
 }
 
+// Map the page at va for process p if it is not mapped yet:
+// from the executable if va lies in a program segment exec()
+// left unmapped, else a zeroed page.  Returns 0 if the page is
+// mapped, -1 if va is beyond p->sz or the page could not be
+// read or allocated.  May sleep, so the caller must not hold
+// a spinlock.
+int
+pagein(struct proc *p, uint va)
+{
+  struct seg *s;
+  pte_t *pte;
+
+  if(cpu->ncli > 0)
+    panic("pagein locks");
+  if(va >= p->sz)
+    return -1;
+  pte = walkpgdir(p->pgdir, (char*)va, 0);
+  if(pte && (*pte & PTE_P))
+    return 0;
+  if(p->exe)
+    for(s = p->seg; s < &p->seg[p->nseg]; s++)
+      if(va >= s->va && va < s->va + s->memsz)
+        return segpagein(p, s, va);
+  return lazyalloc(p->pgdir, va, p->sz);
+}
+
 // Allocate page tables and physical memory to grow process from oldsz to
 // newsz, which need not be page aligned.  Returns new size or 0 on error.
 int
@@ -285,7 +368,7 @@ deallocuvm(pde_t *pgdir, uint oldsz, uint newsz)
 }
 
 // Free a page table and all the physical memory pages
-// in the user part.
+// in the user part.  The kernel part is kpgdir's.
 void
 freevm(pde_t *pgdir)
 {
@@ -294,7 +377,7 @@ freevm(pde_t *pgdir)
   if(pgdir == 0)
     panic("freevm: no pgdir");
   deallocuvm(pgdir, KERNBASE, 0);
-  for(i = 0; i < NPDENTRIES; i++){
+  for(i = 0; i < PDX(KERNBASE); i++){
     if(pgdir[i] & PTE_P){
       char * v = P2V(PTE_ADDR(pgdir[i]));
       kfree(v);
@@ -317,34 +400,151 @@ clearpteu(pde_t *pgdir, char *uva)
 }
 
 // Given a parent process's page table, create a copy
-// of it for a child.
+// of it for a child.  The child shares the parent's pages:
+// writable user pages become read-only copy-on-write in both
+// page tables, and the first write to one copies it (see
+// cowfault).  Kernel-only pages are copied at once.
+// Heap pages not yet touched stay unmapped in both (see
+// lazyalloc).  pgdir must be the current page table.
 pde_t*
 copyuvm(pde_t *pgdir, uint sz)
 {
   pde_t *d;
   pte_t *pte;
-  uint pa, i, flags;
+  uint pa, i, flags, n;
   char *mem;
 
   if((d = setupkvm()) == 0)
     return 0;
+  n = 0;
   for(i = 0; i < sz; i += PGSIZE){
-    if((pte = walkpgdir(pgdir, (void *) i, 0)) == 0)
-      panic("copyuvm: pte should exist");
+    if((pte = walkpgdir(pgdir, (void *) i, 0)) == 0){
+      i = PGADDR(PDX(i) + 1, 0, 0) - PGSIZE;
+      continue;
+    }
     if(!(*pte & PTE_P))
-      panic("copyuvm: page not present");
+      continue;
     pa = PTE_ADDR(*pte);
     flags = PTE_FLAGS(*pte);
-    if((mem = kalloc()) == 0)
-      goto bad;
-    memmove(mem, (char*)P2V(pa), PGSIZE);
-    if(mappages(d, (void*)i, PGSIZE, V2P(mem), flags) < 0)
+    if(!(flags & PTE_U)){
+      // Kernel-only, like the guard page below the stack:
+      // cowfault() does not handle these, so copy it now.
+      if((mem = kalloc()) == 0)
+        goto bad;
+      memmove(mem, (char*)P2V(pa), PGSIZE);
+      if(mappages(d, (void*)i, PGSIZE, V2P(mem), flags) < 0){
+        kfree(mem);
+        goto bad;
+      }
+      continue;
+    }
+    if(flags & PTE_W){
+      *pte = (*pte & ~PTE_W) | PTE_COW;
+      flags = PTE_FLAGS(*pte);
+    }
+    if(mappages(d, (void*)i, PGSIZE, pa, flags) < 0)
       goto bad;
+    kdup(P2V(pa));
+    n++;
   }
+  __sync_fetch_and_add(&vmstat.cowshared, n);
+  // The parent may still have writable entries in its TLB.
+  lcr3(V2P(pgdir));
   return d;
 
 bad:
   freevm(d);
+  lcr3(V2P(pgdir));
+  return 0;
+}
+
+// Handle a write to the copy-on-write page at va in page
+// table pgdir: copy the page, or, if no other
+// page table maps it any more, just make it writable again.
+// Returns -1 if va is not a copy-on-write page or there is
+// no memory for the copy.
+int
+cowfault(pde_t *pgdir, uint va)
+{
+  pte_t *pte;
+  uint pa, flags;
+  char *mem;
+
+  if(va >= KERNBASE || (pte = walkpgdir(pgdir, (char*)va, 0)) == 0)
+    return -1;
+  if((*pte & (PTE_P|PTE_U|PTE_COW)) != (PTE_P|PTE_U|PTE_COW))
+    return -1;
+  __sync_fetch_and_add(&vmstat.cowfaults, 1);
+  pa = PTE_ADDR(*pte);
+  flags = (PTE_FLAGS(*pte) | PTE_W) & ~PTE_COW;
+  if(krefs(P2V(pa)) > 1){
+    if((mem = kalloc()) == 0)
+      return -1;
+    memmove(mem, P2V(pa), PGSIZE);
+    kfree(P2V(pa));
+    pa = V2P(mem);
+    __sync_fetch_and_add(&vmstat.cowcopies, 1);
+  }
+  *pte = pa | flags;
+  invlpg((char*)PGROUNDDOWN(va));
+  return 0;
+}
+
+// Make sure every page of [va, va+len) of process p is
+// mapped and user accessible, so that the kernel can use a
+// user buffer without faulting on it, perhaps while holding a
+// lock.  If write is set, copy-on-write pages are copied now
+// and read-only pages, like program text, are refused.
+// Returns -1 if some of it is beyond p->sz, cannot be paged
+// in, or is kernel-only, like the stack guard page.
+int
+uvmtouch(struct proc *p, uint va, uint len, int write)
+{
+  pte_t *pte;
+  uint a;
+
+  if(len == 0)
+    return 0;
+  if(va + len < va || va + len > p->sz)
+    return -1;
+  for(a = PGROUNDDOWN(va); a < va + len; a += PGSIZE){
+    if(pagein(p, a) < 0)
+      return -1;
+    pte = walkpgdir(p->pgdir, (char*)a, 0);
+    if(pte == 0 || !(*pte & PTE_U))
+      return -1;
+    if(write && !(*pte & PTE_W) && cowfault(p->pgdir, a) < 0)
+      return -1;
+  }
+  return 0;
+}
+
+// Number of pages of [0, sz) that pgdir maps.
+uint
+uvmrss(pde_t *pgdir, uint sz)
+{
+  pte_t *pgtab;
+  uint i, j, n;
+
+  n = 0;
+  for(i = 0; i < PDX(KERNBASE) && PGADDR(i, 0, 0) < sz; i++){
+    if(!(pgdir[i] & PTE_P))
+      continue;
+    pgtab = (pte_t*)P2V(PTE_ADDR(pgdir[i]));
+    for(j = 0; j < NPTENTRIES && PGADDR(i, j, 0) < sz; j++)
+      if(pgtab[j] & PTE_P)
+        n++;
+  }
+  return n;
+}
+
+// Copy out the physical memory and copy-on-write counters.
+int
+getvmstat(struct vmstat *st)
+{
+  *st = vmstat;
+  kallocstat(st);
+  ipagestat(st);
   return 0;
 }
 
@@ -356,7 +556,7 @@ uva2ka(pde_t *pgdir, char *uva)
   pte_t *pte;
 
   pte = walkpgdir(pgdir, uva, 0);
-  if((*pte & PTE_P) == 0)
+  if(pte == 0 || (*pte & PTE_P) == 0)
     return 0;
   if((*pte & PTE_U) == 0)
     return 0;
@@ -365,16 +565,22 @@ uva2ka(pde_t *pgdir, char *uva)
 
 // Copy len bytes from p to user address va in page table pgdir.
 // Most useful when pgdir is not the current page table.
-// uva2ka ensures this only works for PTE_U pages.
+// uva2ka ensures this only works for PTE_U pages.  Writes
+// through the kernel mapping do not fault, so copy-on-write
+// pages are copied here first, and read-only pages fail.
 int
 copyout(pde_t *pgdir, uint va, void *p, uint len)
 {
   char *buf, *pa0;
+  pte_t *pte;
   uint n, va0;
 
   buf = (char*)p;
   while(len > 0){
     va0 = (uint)PGROUNDDOWN(va);
+    pte = walkpgdir(pgdir, (char*)va0, 0);
+    if(pte && !(*pte & PTE_W) && cowfault(pgdir, va0) < 0)
+      return -1;
     pa0 = uva2ka(pgdir, (char*)va0);
     if(pa0 == 0)
       return -1;
@@ -0,0 +1,66 @@
+// waitpid() tests: reaping one child by pid while others are
+// still running, WNOHANG with and without an exited child, and
+// orphans passed to init when their parent exits first.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "proc_type.h"
+
+void
+fail(char *what)
+{
+  printf(1, "waittest: %s FAILED\n", what);
+  exit();
+}
+
+int
+main(int argc, char *argv[])
+{
+  int a, b, fds[2], pid;
+  char c;
+
+  // b exits at once; a blocks on the pipe until we let it go.
+  if(pipe(fds) < 0)
+    fail("pipe");
+  if((a = fork()) == 0){
+    close(fds[1]);
+    read(fds[0], &c, 1);
+    exit();
+  }
+  if((b = fork()) == 0)
+    exit();
+  close(fds[0]);
+
+  if(waitpid(b, 0) != b)
+    fail("waitpid(b)");
+  if(waitpid(b, WNOHANG) != -1)
+    fail("waitpid(b) twice");
+  if(waitpid(a, WNOHANG) != 0)
+    fail("WNOHANG on a running child");
+  if(waitpid(-1, WNOHANG) != 0)
+    fail("WNOHANG on any child");
+  close(fds[1]);
+  if(waitpid(-1, 0) != a)
+    fail("waitpid(-1)");
+  if(waitpid(-1, WNOHANG) != -1)
+    fail("WNOHANG without children");
+  if(waitpid(getpid(), 0) != -1)
+    fail("waitpid(self)");
+
+  // The grandchild outlives its parent and goes to init.
+  if((pid = fork()) == 0){
+    if(fork() == 0){
+      sleep(10);
+      exit();
+    }
+    exit();
+  }
+  if(wait() != pid)
+    fail("wait for orphaning parent");
+  if(wait() != -1)
+    fail("orphan not passed to init");
+
+  printf(1, "waittest: ok\n");
+  exit();
+}
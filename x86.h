@@ -117,6 +117,15 @@ sti(void)
   asm volatile("sti");
 }
 
+// Enable interrupts and halt until one arrives.  sti only
+// takes effect after the next instruction, so no interrupt
+// can be taken between the two and then missed by hlt.
+static inline void
+stihlt(void)
+{
+  asm volatile("sti; hlt" : : : "memory");
+}
+
 static inline uint
 xchg(volatile uint *addr, uint newval)
 {
@@ -144,6 +153,55 @@ lcr3(uint val)
   asm volatile("movl %0,%%cr3" : : "r" (val));
 }
 
+// Flush the TLB entry for the page holding addr.
+static inline void
+invlpg(void *addr)
+{
+  asm volatile("invlpg (%0)" : : "r" (addr) : "memory");
+}
+
+// Index of the least significant set bit of v.
+// Undefined if v is zero.
+static inline uint
+bsf(uint v)
+{
+  uint r;
+  asm volatile("bsfl %1,%0" : "=r" (r) : "rm" (v) : "cc");
+  return r;
+}
+
+// Index of the most significant set bit of v.
+// Undefined if v is zero.
+static inline uint
+bsr(uint v)
+{
+  uint r;
+  asm volatile("bsrl %1,%0" : "=r" (r) : "rm" (v) : "cc");
+  return r;
+}
+
+// Divide n by d, which must be larger than the high half of
+// n so that the quotient fits in 32 bits.  Stores the
+// remainder in *rem if rem is non-zero.
+static inline uint
+divl(uint64 n, uint d, uint *rem)
+{
+  uint q, r;
+  asm volatile("divl %4" : "=a" (q), "=d" (r)
+               : "a" ((uint)n), "d" ((uint)(n >> 32)), "rm" (d) : "cc");
+  if(rem)
+    *rem = r;
+  return q;
+}
+
+static inline uint64
+rdtsc(void)
+{
+  uint lo, hi;
+  asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64)hi << 32) | lo;
+}
+
 //PAGEBREAK: 36
 // Layout of the trap frame built on the stack by the
 // hardware and by trapasm.S, and passed to trap().